@@ -16,6 +16,7 @@ HEADERS += systray.h
 INCLUDEPATH += ../lib
 LIBS += -L../lib -lDisks
 
+include(../../lumina-trace/lumina-trace.pri)
 include(../../lumina-extra.pri)
 
 target.path = $${PREFIX}/bin
@@ -6,11 +6,19 @@
 */
 
 #include "systray.h"
+#include "tracering.h"
 #include <QApplication>
 
+#include <signal.h>
+
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // SIGUSR1 dumps the trace ring to the runtime dir
+    TraceRing::setName("lumina-disk-manager");
+    TraceRing::installSignalHandler(SIGUSR1);
+
     SysTray tray(a.parent());
     return a.exec();
 }
@@ -6,6 +6,7 @@
 */
 
 #include "systray.h"
+#include "tracering.h"
 #include <QIcon>
 #include <QProcess>
 #include <QTimer>
@@ -110,14 +111,17 @@ void SysTray::handleContextMenuAction()
     generateContextMenu();
 }
 
+// devices are traced by path hash
 void SysTray::handleDeviceError(QString path, QString error)
 {
+    TraceRing::record(traceDiskError, qHash(path));
     if (!man->devices.contains(path)) { return; }
     showMessage(QObject::tr("Error for device %1").arg(man->devices[path]->name), error);
 }
 
 void SysTray::handleDeviceMediaChanged(QString path, bool media)
 {
+    TraceRing::record(traceDiskMedia, qHash(path), media);
     if (!man->devices.contains(path)) { return; }
     generateContextMenu();
     if (man->devices[path]->isOptical && media) {
@@ -133,6 +137,7 @@ void SysTray::handleDeviceMediaChanged(QString path, bool media)
 
 void SysTray::handleDeviceMountpointChanged(QString path, QString mountpoint)
 {
+    TraceRing::record(traceDiskMount, qHash(path), !mountpoint.isEmpty());
     if (!man->devices.contains(path)) { return; }
     generateContextMenu();
     if (!man->devices[path]->isRemovable) { return; }
@@ -151,6 +156,7 @@ void SysTray::openMountpoint(QString mountpoint)
 
 void SysTray::handleFoundNewDevice(QString path)
 {
+    TraceRing::record(traceDiskFound, qHash(path));
     if (!man->devices.contains(path)) { return; }
     showMessage(QString("Found %1").arg(man->devices[path]->name), QString("Found a new device (%1)").arg(man->devices[path]->dev));
 }
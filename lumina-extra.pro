@@ -13,4 +13,5 @@ SUBDIRS += \
     lumina-disk-manager \
     lumina-keyboard-manager \
     lumina-power-manager \
+    lumina-trace \
 #    lumina-pixel
@@ -10,6 +10,7 @@
 
 #include <QSettings>
 #include <QVariant>
+#include <QMap>
 
 enum lidAction
 {
@@ -32,6 +33,9 @@ enum criticalAction
 
 #define LOW_BATTERY 15
 #define CRITICAL_BATTERY 10
+#define DIM_BRIGHTNESS 30
+#define POWER_SUPPLY_SYSFS "/sys/class/power_supply"
+#define BACKLIGHT_SYSFS "/sys/class/backlight"
 #define AUTO_SLEEP_BATTERY 15
 #define DEFAULT_BATTERY_ICON "battery"
 #define DEFAULT_BATTERY_ICON_CRIT "battery-caution"
@@ -48,6 +52,231 @@ enum criticalAction
 
 #define PM_SERVICE "org.freedesktop.PowerManagement"
 #define PM_PATH "/PowerManagement"
+#define SS_SERVICE "org.freedesktop.ScreenSaver"
+#define SS_PATH "/ScreenSaver"
+#define LPM_SERVICE "org.lumina.PowerManager"
+#define LPM_PATH "/PowerManager"
+#define LPM_INTERFACE "org.lumina.PowerManager"
+#define LPM_METRICS_PATH "/PowerManager/Metrics"
+
+#define LOGIND_SERVICE "org.freedesktop.login1"
+#define LOGIND_PATH "/org/freedesktop/login1"
+#define LOGIND_MANAGER "org.freedesktop.login1.Manager"
+
+enum powerConfigField
+{
+    configAutoSleepBattery = 0x1,
+    configAutoSleepAC = 0x2,
+    configLowBattery = 0x4,
+    configCriticalBattery = 0x8,
+    configLidBattery = 0x10,
+    configLidAC = 0x20,
+    configCriticalAction = 0x40,
+    configDesktopSS = 0x80,
+    configDesktopPM = 0x100,
+    configTrayNotify = 0x200,
+    configShowBatteryPercent = 0x400,
+    configShowTray = 0x800,
+    configDisableLidBatteryExternalMonitor = 0x1000,
+    configDisableLidACExternalMonitor = 0x2000,
+    configCriticalPredict = 0x4000,
+    configScreenOffBattery = 0x8000,
+    configScreenOffAC = 0x10000,
+    configLockBattery = 0x20000,
+    configLockAC = 0x40000,
+    configBrightnessBattery = 0x80000,
+    configBrightnessAC = 0x100000,
+    configDimBattery = 0x200000,
+    configDimAC = 0x400000,
+    configSysfsBackend = 0x800000,
+    configPowerSupplyRoot = 0x1000000,
+    configInhibitTimeout = 0x2000000,
+    configBacklightRoot = 0x4000000
+};
+
+// typed snapshot of the power settings, loaded in one pass
+struct PowerConfig
+{
+    int autoSleepBattery;
+    int autoSleepAC;
+    int lowBattery;
+    int criticalBattery;
+    int lidBattery;
+    int lidAC;
+    int criticalAction;
+    bool desktopSS;
+    bool desktopPM;
+    bool trayNotify;
+    bool showBatteryPercent;
+    bool showTray;
+    bool disableLidBatteryExternalMonitor;
+    bool disableLidACExternalMonitor;
+    bool criticalPredict;
+    int screenOffBattery;
+    int screenOffAC;
+    int lockBattery;
+    int lockAC;
+    int brightnessBattery;
+    int brightnessAC;
+    int dimBattery;
+    int dimAC;
+    bool sysfsBackend;
+    QString powerSupplyRoot;
+    int inhibitTimeout;
+    QString backlightRoot;
+
+    PowerConfig()
+        : autoSleepBattery(AUTO_SLEEP_BATTERY)
+        , autoSleepAC(0) // don't add default on AC, not all (normal) machines support suspend.
+        , lowBattery(LOW_BATTERY)
+        , criticalBattery(CRITICAL_BATTERY)
+        , lidBattery(LID_BATTERY_DEFAULT)
+        , lidAC(LID_AC_DEFAULT)
+        , criticalAction(CRITICAL_DEFAULT)
+        , desktopSS(true)
+        , desktopPM(true)
+        , trayNotify(true)
+        , showBatteryPercent(true)
+        , showTray(true)
+        , disableLidBatteryExternalMonitor(true)
+        , disableLidACExternalMonitor(true)
+        , criticalPredict(false)
+        , screenOffBattery(0)
+        , screenOffAC(0)
+        , lockBattery(0)
+        , lockAC(0)
+        , brightnessBattery(0) // 0 leaves brightness alone
+        , brightnessAC(0)
+        , dimBattery(0)
+        , dimAC(0)
+        , sysfsBackend(false)
+        , powerSupplyRoot(POWER_SUPPLY_SYSFS)
+        , inhibitTimeout(0) // minutes, 0 keeps inhibitors until released
+        , backlightRoot(BACKLIGHT_SYSFS)
+    {
+    }
+
+    static PowerConfig load()
+    {
+        PowerConfig config;
+        QSettings settings("lumina-desktop", "lumina-power");
+        config.autoSleepBattery = settings.value("autoSleepBattery", config.autoSleepBattery).toInt();
+        config.autoSleepAC = settings.value("autoSleepAC", config.autoSleepAC).toInt();
+        config.lowBattery = settings.value("lowBattery", config.lowBattery).toInt();
+        config.criticalBattery = settings.value("criticalBattery", config.criticalBattery).toInt();
+        config.lidBattery = settings.value("lidBattery", config.lidBattery).toInt();
+        config.lidAC = settings.value("lidAC", config.lidAC).toInt();
+        config.criticalAction = settings.value("criticalAction", config.criticalAction).toInt();
+        config.desktopSS = settings.value("desktop_ss", config.desktopSS).toBool();
+        config.desktopPM = settings.value("desktop_pm", config.desktopPM).toBool();
+        config.trayNotify = settings.value("tray_notify", config.trayNotify).toBool();
+        config.showBatteryPercent = settings.value("show_battery_percent", config.showBatteryPercent).toBool();
+        config.showTray = settings.value("show_tray", config.showTray).toBool();
+        config.disableLidBatteryExternalMonitor = settings.value("disable_lid_action_battery_external_monitor", config.disableLidBatteryExternalMonitor).toBool();
+        config.disableLidACExternalMonitor = settings.value("disable_lid_action_ac_external_monitor", config.disableLidACExternalMonitor).toBool();
+        config.criticalPredict = settings.value("critical_predict", config.criticalPredict).toBool();
+        config.screenOffBattery = settings.value("screen_off_battery", config.screenOffBattery).toInt();
+        config.screenOffAC = settings.value("screen_off_ac", config.screenOffAC).toInt();
+        config.lockBattery = settings.value("lock_battery", config.lockBattery).toInt();
+        config.lockAC = settings.value("lock_ac", config.lockAC).toInt();
+        config.brightnessBattery = settings.value("brightness_battery", config.brightnessBattery).toInt();
+        config.brightnessAC = settings.value("brightness_ac", config.brightnessAC).toInt();
+        config.dimBattery = settings.value("dim_battery", config.dimBattery).toInt();
+        config.dimAC = settings.value("dim_ac", config.dimAC).toInt();
+        config.sysfsBackend = settings.value("sysfs_backend", config.sysfsBackend).toBool();
+        config.powerSupplyRoot = settings.value("power_supply_root", config.powerSupplyRoot).toString();
+        config.inhibitTimeout = settings.value("inhibit_timeout", config.inhibitTimeout).toInt();
+        config.backlightRoot = settings.value("backlight_root", config.backlightRoot).toString();
+        return config;
+    }
+
+    // set field from settings key, returns the changed field (or 0),
+    // -1 if the key is not a power setting
+    int setValue(const QString &key, const QVariant &value)
+    {
+        PowerConfig old = *this;
+        if (key == "autoSleepBattery") { autoSleepBattery = value.toInt(); }
+        else if (key == "autoSleepAC") { autoSleepAC = value.toInt(); }
+        else if (key == "lowBattery") { lowBattery = value.toInt(); }
+        else if (key == "criticalBattery") { criticalBattery = value.toInt(); }
+        else if (key == "lidBattery") { lidBattery = value.toInt(); }
+        else if (key == "lidAC") { lidAC = value.toInt(); }
+        else if (key == "criticalAction") { criticalAction = value.toInt(); }
+        else if (key == "desktop_ss") { desktopSS = value.toBool(); }
+        else if (key == "desktop_pm") { desktopPM = value.toBool(); }
+        else if (key == "tray_notify") { trayNotify = value.toBool(); }
+        else if (key == "show_battery_percent") { showBatteryPercent = value.toBool(); }
+        else if (key == "show_tray") { showTray = value.toBool(); }
+        else if (key == "disable_lid_action_battery_external_monitor") { disableLidBatteryExternalMonitor = value.toBool(); }
+        else if (key == "disable_lid_action_ac_external_monitor") { disableLidACExternalMonitor = value.toBool(); }
+        else if (key == "critical_predict") { criticalPredict = value.toBool(); }
+        else if (key == "screen_off_battery") { screenOffBattery = value.toInt(); }
+        else if (key == "screen_off_ac") { screenOffAC = value.toInt(); }
+        else if (key == "lock_battery") { lockBattery = value.toInt(); }
+        else if (key == "lock_ac") { lockAC = value.toInt(); }
+        else if (key == "brightness_battery") { brightnessBattery = value.toInt(); }
+        else if (key == "brightness_ac") { brightnessAC = value.toInt(); }
+        else if (key == "dim_battery") { dimBattery = value.toInt(); }
+        else if (key == "dim_ac") { dimAC = value.toInt(); }
+        else if (key == "sysfs_backend") { sysfsBackend = value.toBool(); }
+        else if (key == "power_supply_root") { powerSupplyRoot = value.toString(); }
+        else if (key == "inhibit_timeout") { inhibitTimeout = value.toInt(); }
+        else if (key == "backlight_root") { backlightRoot = value.toString(); }
+        else { return -1; }
+        return old.diff(*this);
+    }
+
+    // write several settings at once
+    static void save(const QVariantMap &values)
+    {
+        QSettings settings("lumina-desktop", "lumina-power");
+        QMapIterator<QString, QVariant> i(values);
+        while (i.hasNext()) {
+            i.next();
+            settings.setValue(i.key(), i.value());
+        }
+    }
+
+    static QString fileName()
+    {
+        QSettings settings("lumina-desktop", "lumina-power");
+        return settings.fileName();
+    }
+
+    // fields that differ from other, see powerConfigField
+    int diff(const PowerConfig &other) const
+    {
+        int result = 0;
+        if (autoSleepBattery != other.autoSleepBattery) { result |= configAutoSleepBattery; }
+        if (autoSleepAC != other.autoSleepAC) { result |= configAutoSleepAC; }
+        if (lowBattery != other.lowBattery) { result |= configLowBattery; }
+        if (criticalBattery != other.criticalBattery) { result |= configCriticalBattery; }
+        if (lidBattery != other.lidBattery) { result |= configLidBattery; }
+        if (lidAC != other.lidAC) { result |= configLidAC; }
+        if (criticalAction != other.criticalAction) { result |= configCriticalAction; }
+        if (desktopSS != other.desktopSS) { result |= configDesktopSS; }
+        if (desktopPM != other.desktopPM) { result |= configDesktopPM; }
+        if (trayNotify != other.trayNotify) { result |= configTrayNotify; }
+        if (showBatteryPercent != other.showBatteryPercent) { result |= configShowBatteryPercent; }
+        if (showTray != other.showTray) { result |= configShowTray; }
+        if (disableLidBatteryExternalMonitor != other.disableLidBatteryExternalMonitor) { result |= configDisableLidBatteryExternalMonitor; }
+        if (disableLidACExternalMonitor != other.disableLidACExternalMonitor) { result |= configDisableLidACExternalMonitor; }
+        if (criticalPredict != other.criticalPredict) { result |= configCriticalPredict; }
+        if (screenOffBattery != other.screenOffBattery) { result |= configScreenOffBattery; }
+        if (screenOffAC != other.screenOffAC) { result |= configScreenOffAC; }
+        if (lockBattery != other.lockBattery) { result |= configLockBattery; }
+        if (lockAC != other.lockAC) { result |= configLockAC; }
+        if (brightnessBattery != other.brightnessBattery) { result |= configBrightnessBattery; }
+        if (brightnessAC != other.brightnessAC) { result |= configBrightnessAC; }
+        if (dimBattery != other.dimBattery) { result |= configDimBattery; }
+        if (dimAC != other.dimAC) { result |= configDimAC; }
+        if (sysfsBackend != other.sysfsBackend) { result |= configSysfsBackend; }
+        if (powerSupplyRoot != other.powerSupplyRoot) { result |= configPowerSupplyRoot; }
+        if (inhibitTimeout != other.inhibitTimeout) { result |= configInhibitTimeout; }
+        if (backlightRoot != other.backlightRoot) { result |= configBacklightRoot; }
+        return result;
+    }
+};
 
 class Common
 {
@@ -0,0 +1,30 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# headless power manager, no widgets. the tray in ../manager is an optional client.
+QT = core dbus
+
+TARGET = lumina-power-daemon
+TEMPLATE = app
+CONFIG -= app_bundle
+
+VPATH += ../manager
+SOURCES += main.cpp powerdaemon.cpp xconnection.cpp topology.cpp hotplug.cpp layout.cpp profilestore.cpp batteryhistory.cpp kernellog.cpp policy.cpp latencytrace.cpp idletimer.cpp idlescheduler.cpp dpms.cpp backlight.cpp powersupply.cpp configwatcher.cpp powerservice.cpp powermetrics.cpp powerbackend.cpp inhibitregistry.cpp inhibitservice.cpp
+HEADERS += powerdaemon.h xconnection.h topology.h hotplug.h layout.h profilestore.h batteryhistory.h kernellog.h policy.h latencytrace.h idletimer.h idlescheduler.h dpms.h backlight.h powersupply.h configwatcher.h powerservice.h powermetrics.h powerbackend.h inhibitregistry.h inhibitservice.h
+LIBS += -L../lib -lPower
+INCLUDEPATH += .. ../lib ../manager
+
+CONFIG += link_pkgconfig
+PKGCONFIG += x11 xext xscrnsaver xrandr
+
+include(../../lumina-trace/lumina-trace.pri)
+include(../../lumina-extra.pri)
+
+target.path = $${PREFIX}/bin
+target_docs.path = $${DOCDIR}/$${TARGET}-$${VERSION}
+target_docs.files = ../../LICENSE ../../README.md
+INSTALLS += target target_docs
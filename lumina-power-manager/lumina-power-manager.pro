@@ -8,7 +8,9 @@
 
 TEMPLATE = subdirs
 CONFIG -= ordered
-SUBDIRS += lib settings manager
+SUBDIRS += lib settings manager daemon tests
 
 lib.file = lib/libpower.pro
 manager.depends += lib
+daemon.depends += lib
+tests.depends += lib
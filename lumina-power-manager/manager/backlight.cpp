@@ -0,0 +1,169 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "backlight.h"
+
+#include <QDir>
+#include <QDebug>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
+
+Backlight::Backlight(XConnection *connection, const QString &sysfsRoot, QObject *parent) :
+    QObject(parent)
+  , xcon(connection)
+  , output(0)
+  , atom(0)
+  , minValue(0)
+  , maxValue(0)
+  , timer(0)
+  , fadeFrom(0)
+  , fadeTo(0)
+  , fadeStep(0)
+  , fadeSteps(0)
+{
+    timer = new QTimer(this);
+    connect(timer, SIGNAL(timeout()), this, SLOT(handleFadeStep()));
+
+    findOutput();
+    if (!output) { findSysfs(sysfsRoot); }
+    if (!isValid()) { qWarning("No backlight control available."); }
+}
+
+bool Backlight::isValid()
+{
+    return maxValue>minValue;
+}
+
+bool Backlight::isFading()
+{
+    return timer->isActive();
+}
+
+// first output with a settable Backlight property
+void Backlight::findOutput()
+{
+    if (!xcon || !xcon->isValid() || xcon->randrEventBase()<0) { return; }
+    Display *dpy = xcon->display();
+    XRoundTrip trip(xcon);
+
+    Atom backlight = XInternAtom(dpy, RR_PROPERTY_BACKLIGHT, True);
+    if (backlight == None) { backlight = XInternAtom(dpy, "BACKLIGHT", True); }
+    if (backlight == None) { return; }
+
+    XRRScreenResources *sr = XRRGetScreenResourcesCurrent(dpy, xcon->rootWindow());
+    if (sr == NULL) { return; }
+    for (int i=0;i<sr->noutput && !output;++i) {
+        XRRPropertyInfo *info = XRRQueryOutputProperty(dpy, sr->outputs[i], backlight);
+        if (info == NULL) { continue; }
+        if (info->range && info->num_values == 2 && !info->immutable) {
+            output = sr->outputs[i];
+            atom = backlight;
+            minValue = info->values[0];
+            maxValue = info->values[1];
+        }
+        XFree(info);
+    }
+    XRRFreeScreenResources(sr);
+}
+
+// first device under root, the brightness file is kept open
+void Backlight::findSysfs(const QString &root)
+{
+    QDir dir(root);
+    QStringList devices = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot, QDir::Name);
+    for (int i=0;i<devices.size();++i) {
+        QFile max(QString("%1/%2/max_brightness").arg(root).arg(devices.at(i)));
+        if (!max.open(QIODevice::ReadOnly)) { continue; }
+        long value = max.readAll().trimmed().toLong();
+        if (value<=0) { continue; }
+        sysfs.setFileName(QString("%1/%2/brightness").arg(root).arg(devices.at(i)));
+        if (!sysfs.open(QIODevice::ReadWrite|QIODevice::Unbuffered)) { continue; }
+        minValue = 0;
+        maxValue = value;
+        return;
+    }
+}
+
+long Backlight::readValue()
+{
+    if (output) {
+        Atom actualType;
+        int actualFormat;
+        unsigned long nitems, bytesAfter;
+        unsigned char *prop = NULL;
+        long result = minValue;
+        XRoundTrip trip(xcon);
+        if (XRRGetOutputProperty(xcon->display(), output, atom, 0, 4, False, False, None,
+                                 &actualType, &actualFormat, &nitems, &bytesAfter, &prop) == Success) {
+            if (prop && actualType == XA_INTEGER && actualFormat == 32 && nitems == 1) { result = *((long*)prop); }
+            if (prop) { XFree(prop); }
+        }
+        return result;
+    }
+    // first line only, a regular file may keep digits from a longer write
+    if (!sysfs.isOpen() || !sysfs.seek(0)) { return minValue; }
+    return sysfs.readLine(32).trimmed().toLong();
+}
+
+void Backlight::writeValue(long value)
+{
+    value = qBound(minValue, value, maxValue);
+    if (output) {
+        XRRChangeOutputProperty(xcon->display(), output, atom, XA_INTEGER, 32, PropModeReplace,
+                                (unsigned char*)&value, 1);
+        xcon->flush();
+        return;
+    }
+    if (!sysfs.isOpen() || !sysfs.seek(0)) { return; }
+    sysfs.write(QByteArray::number((qlonglong)value)+"\n");
+}
+
+int Backlight::brightness()
+{
+    if (!isValid()) { return -1; }
+    return qRound((double)(readValue()-minValue)*100.0/(double)(maxValue-minValue));
+}
+
+void Backlight::setBrightness(int percent)
+{
+    if (!isValid()) { return; }
+    stop();
+    percent = qBound(0, percent, 100);
+    writeValue(minValue+qRound((double)(maxValue-minValue)*percent/100.0));
+}
+
+// ramp to percent over msec, steps are bounded and frame paced
+void Backlight::fade(int percent, int msec)
+{
+    if (!isValid()) { return; }
+    stop();
+    fadeFrom = brightness();
+    fadeTo = qBound(0, percent, 100);
+    if (fadeFrom == fadeTo) { return; }
+    fadeSteps = qBound(1, msec/BACKLIGHT_FRAME, BACKLIGHT_MAX_STEPS);
+    fadeSteps = qMin(fadeSteps, qAbs(fadeTo-fadeFrom));
+    fadeStep = 0;
+    timer->setInterval(qMax(BACKLIGHT_FRAME, msec/fadeSteps));
+    timer->start();
+}
+
+void Backlight::stop()
+{
+    timer->stop();
+}
+
+void Backlight::handleFadeStep()
+{
+    fadeStep++;
+    int percent = fadeFrom+(fadeTo-fadeFrom)*fadeStep/fadeSteps;
+    writeValue(minValue+qRound((double)(maxValue-minValue)*percent/100.0));
+    if (fadeStep>=fadeSteps) { timer->stop(); }
+}
@@ -0,0 +1,63 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <QObject>
+#include <QTimer>
+#include <QFile>
+
+#include "xconnection.h"
+#include "common.h"
+
+// fades run at most this many steps, no faster than one step per frame
+#define BACKLIGHT_MAX_STEPS 20
+#define BACKLIGHT_FRAME 16
+
+// backlight through the RandR Backlight output property, falls back
+// to sysfs (needs write access to the brightness file).
+// brightness is in percent.
+class Backlight : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Backlight(XConnection *connection, const QString &sysfsRoot = BACKLIGHT_SYSFS, QObject *parent = NULL);
+    bool isValid();
+    bool isFading();
+    int brightness();
+
+private:
+    XConnection *xcon;
+    unsigned long output;
+    unsigned long atom;
+    QFile sysfs;
+    long minValue;
+    long maxValue;
+    QTimer *timer;
+    int fadeFrom;
+    int fadeTo;
+    int fadeStep;
+    int fadeSteps;
+    void findOutput();
+    void findSysfs(const QString &root);
+    long readValue();
+    void writeValue(long value);
+
+public slots:
+    void setBrightness(int percent);
+    void fade(int percent, int msec);
+    void stop();
+
+private slots:
+    void handleFadeStep();
+};
+
+#endif // BACKLIGHT_H
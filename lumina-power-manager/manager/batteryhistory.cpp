@@ -0,0 +1,221 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "batteryhistory.h"
+#include "common.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDebug>
+#include <cstring>
+#include <cmath>
+
+BatteryHistory::BatteryHistory(const QString &fileName)
+    : file(fileName)
+    , data(NULL)
+    , header(NULL)
+    , samples(NULL)
+    , hasLast(false)
+    , energy(-1)
+    , onAC(false)
+    , actionSlept(0)
+{
+    memset(&last, 0, sizeof(last));
+    open();
+}
+
+BatteryHistory::~BatteryHistory()
+{
+    if (data) { file.unmap(data); }
+    file.close();
+}
+
+// next to the settings file
+QString BatteryHistory::fileName()
+{
+    return QString("%1/lumina-power-history.dat").arg(QFileInfo(PowerConfig::fileName()).absolutePath());
+}
+
+// map the ring, a file with another layout is reset
+void BatteryHistory::open()
+{
+    QDir().mkpath(QFileInfo(file.fileName()).absolutePath());
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "cannot open battery history" << file.fileName();
+        return;
+    }
+    qint64 size = sizeof(BatteryHistoryHeader)+(qint64)BATTERY_HISTORY_SIZE*sizeof(BatterySample);
+    bool reset = file.size() != size;
+    if (reset && !file.resize(size)) { return; }
+    if ((data = file.map(0, size)) == NULL) { return; }
+    header = (BatteryHistoryHeader*)data;
+    samples = (BatterySample*)(data+sizeof(BatteryHistoryHeader));
+    if (reset || header->magic != BATTERY_HISTORY_MAGIC || header->version != BATTERY_HISTORY_VERSION ||
+        header->capacity != BATTERY_HISTORY_SIZE || header->head >= BATTERY_HISTORY_SIZE) {
+        memset(data, 0, size);
+        header->magic = BATTERY_HISTORY_MAGIC;
+        header->version = BATTERY_HISTORY_VERSION;
+        header->capacity = BATTERY_HISTORY_SIZE;
+    }
+    if (header->count>0) {
+        last = sample(header->count-1);
+        hasLast = true;
+    }
+}
+
+bool BatteryHistory::isValid()
+{
+    return header != NULL;
+}
+
+int BatteryHistory::count()
+{
+    if (!header) { return 0; }
+    return header->count;
+}
+
+// 0 is the oldest sample
+BatterySample BatteryHistory::sample(int index)
+{
+    BatterySample result;
+    memset(&result, 0, sizeof(result));
+    if (!header || index<0 || index>=(int)header->count) { return result; }
+    int pos = (header->head+BATTERY_HISTORY_SIZE-header->count+index)%BATTERY_HISTORY_SIZE;
+    return samples[pos];
+}
+
+// rates are only learned between samples with the same power source,
+// samples closer than BATTERY_HISTORY_INTERVAL are merged unless
+// the power source changed, gaps (suspend, restart) are not learned
+void BatteryHistory::addSample(double value, bool ac, qint64 timestamp)
+{
+    energy = value;
+    onAC = ac;
+    if (!header || value<0) { return; }
+    if (timestamp<0) { timestamp = QDateTime::currentMSecsSinceEpoch(); }
+    if (hasLast && (bool)last.ac == ac && timestamp-last.timestamp < BATTERY_HISTORY_INTERVAL*1000) { return; }
+
+    BatterySample current;
+    memset(&current, 0, sizeof(current));
+    current.timestamp = timestamp;
+    current.energy = value;
+    current.ac = ac;
+    if (hasLast && (bool)last.ac == ac && timestamp>last.timestamp &&
+        timestamp-last.timestamp <= BATTERY_HISTORY_MAX_GAP*1000) {
+        double hours = (double)(timestamp-last.timestamp)/3600000.0;
+        current.rate = (last.energy-value)/hours;
+        // time weighted ewma, irregular upower updates are fine
+        double alpha = 1.0-exp(-(hours*3600.0)/BATTERY_HISTORY_TAU);
+        // percent steps are coarse, flat intervals are averaged in too
+        if (!ac && current.rate>=0) {
+            header->dischargeRate = header->dischargeRate>0?header->dischargeRate+alpha*(current.rate-header->dischargeRate):current.rate;
+        } else if (ac && current.rate<=0 && value<100) {
+            header->chargeRate = header->chargeRate>0?header->chargeRate+alpha*(-current.rate-header->chargeRate):-current.rate;
+        }
+    }
+
+    samples[header->head] = current;
+    header->head = (header->head+1)%BATTERY_HISTORY_SIZE;
+    if (header->count<BATTERY_HISTORY_SIZE) { header->count++; }
+    last = current;
+    hasLast = true;
+}
+
+double BatteryHistory::dischargeRate()
+{
+    if (!header) { return 0; }
+    return header->dischargeRate;
+}
+
+double BatteryHistory::chargeRate()
+{
+    if (!header) { return 0; }
+    return header->chargeRate;
+}
+
+// seconds, -1 if unknown
+qint64 BatteryHistory::timeToEmpty()
+{
+    if (onAC || energy<=0 || dischargeRate()<=0) { return -1; }
+    return (qint64)(energy/dischargeRate()*3600.0);
+}
+
+qint64 BatteryHistory::timeToFull()
+{
+    if (!onAC || energy<0 || energy>=100 || chargeRate()<=0) { return -1; }
+    return (qint64)((100.0-energy)/chargeRate()*3600.0);
+}
+
+// critical hibernate requested, see finishAction
+void BatteryHistory::startAction(qint64 timestamp)
+{
+    if (!header) { return; }
+    if (timestamp<0) { timestamp = QDateTime::currentMSecsSinceEpoch(); }
+    header->actionStarted = timestamp;
+    actionSlept = 0;
+}
+
+// the system is about to hibernate, a stale request
+// (sleep from somewhere else later on) is dropped
+void BatteryHistory::sleepAction(qint64 timestamp)
+{
+    if (!header || header->actionStarted<=0) { return; }
+    if (timestamp<0) { timestamp = QDateTime::currentMSecsSinceEpoch(); }
+    if (timestamp-header->actionStarted>BATTERY_ACTION_TIMEOUT*1000LL) {
+        cancelAction();
+        return;
+    }
+    actionSlept = timestamp;
+}
+
+// resumed from hibernate, learn how long it took from the request.
+// written is the image write time logged by the kernel, else the
+// whole request to resume gap is used, a long one is not learned
+void BatteryHistory::finishAction(qint64 timestamp, double written)
+{
+    if (!header || header->actionStarted<=0 || actionSlept<=0) {
+        cancelAction();
+        return;
+    }
+    if (timestamp<0) { timestamp = QDateTime::currentMSecsSinceEpoch(); }
+    double duration = written>=0?(double)(actionSlept-header->actionStarted)/1000.0+written:
+                                 (double)(timestamp-header->actionStarted)/1000.0;
+    cancelAction();
+    if (duration<0 || duration>BATTERY_ACTION_TIMEOUT) { return; }
+    // slow runs count more, running out early is worse than acting early.
+    // one odd run moves the estimate at most one step
+    double learned = actionDuration();
+    double step = (duration-learned)*(duration>learned?0.5:0.25);
+    header->actionDuration = learned+qBound((double)-BATTERY_ACTION_STEP, step, (double)BATTERY_ACTION_STEP);
+    qDebug() << "critical hibernate took" << duration << "s, learned" << header->actionDuration << "s";
+}
+
+// the request failed, nothing to learn
+void BatteryHistory::cancelAction()
+{
+    actionSlept = 0;
+    if (!header) { return; }
+    header->actionStarted = 0;
+}
+
+// seconds
+double BatteryHistory::actionDuration()
+{
+    if (!header || header->actionDuration<=0) { return BATTERY_ACTION_DEFAULT; }
+    return header->actionDuration;
+}
+
+// battery runs out before the critical action can finish
+bool BatteryHistory::isCritical()
+{
+    qint64 empty = timeToEmpty();
+    if (empty<0) { return false; }
+    return empty <= actionDuration()+BATTERY_ACTION_MARGIN;
+}
@@ -0,0 +1,91 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef BATTERYHISTORY_H
+#define BATTERYHISTORY_H
+
+#include <QString>
+#include <QFile>
+
+#define BATTERY_HISTORY_MAGIC 0x4c504248
+#define BATTERY_HISTORY_VERSION 2
+#define BATTERY_HISTORY_SIZE 4096
+// smoothing time constant, minimum sample interval and max gap in seconds
+#define BATTERY_HISTORY_TAU 600
+#define BATTERY_HISTORY_INTERVAL 60
+#define BATTERY_HISTORY_MAX_GAP 1800
+// hibernate duration until learned and safety margin in seconds
+#define BATTERY_ACTION_DEFAULT 30
+#define BATTERY_ACTION_MARGIN 120
+// a request or resume after this is not timed, max learning step (seconds)
+#define BATTERY_ACTION_TIMEOUT 300
+#define BATTERY_ACTION_STEP 30
+
+// energy is in percent unless the backend knows Wh, rate is energy per hour
+struct BatterySample
+{
+    qint64 timestamp;
+    float energy;
+    float rate;
+    quint32 ac;
+    quint32 reserved;
+};
+
+struct BatteryHistoryHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 capacity;
+    quint32 head;
+    quint32 count;
+    quint32 reserved;
+    double dischargeRate;
+    double chargeRate;
+    double actionDuration;
+    qint64 actionStarted;
+};
+
+// fixed size ring of battery samples mapped from disk, with
+// exponentially smoothed charge/discharge rates kept in the header.
+// adding a sample and reading an estimate is O(1).
+class BatteryHistory
+{
+public:
+    explicit BatteryHistory(const QString &fileName);
+    ~BatteryHistory();
+    static QString fileName();
+    bool isValid();
+    int count();
+    BatterySample sample(int index);
+    void addSample(double energy, bool ac, qint64 timestamp = -1);
+    double dischargeRate();
+    double chargeRate();
+    qint64 timeToEmpty();
+    qint64 timeToFull();
+    void startAction(qint64 timestamp = -1);
+    void sleepAction(qint64 timestamp = -1);
+    void finishAction(qint64 timestamp = -1, double written = -1);
+    void cancelAction();
+    double actionDuration();
+    bool isCritical();
+
+private:
+    QFile file;
+    uchar *data;
+    BatteryHistoryHeader *header;
+    BatterySample *samples;
+    BatterySample last;
+    bool hasLast;
+    double energy;
+    bool onAC;
+    qint64 actionSlept;
+    void open();
+};
+
+#endif // BATTERYHISTORY_H
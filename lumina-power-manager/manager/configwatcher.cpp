@@ -0,0 +1,80 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "configwatcher.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+
+ConfigWatcher::ConfigWatcher(const QString &fileName, QObject *parent) :
+    QObject(parent)
+  , file(fileName)
+  , watcher(0)
+  , timer(0)
+{
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, SIGNAL(fileChanged(QString)), this, SLOT(handleChanged()));
+    connect(watcher, SIGNAL(directoryChanged(QString)), this, SLOT(handleDirectoryChanged()));
+
+    // QSettings writes several times in a row, only reload once
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(100);
+    connect(timer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+
+    stamp = fileStamp();
+    watch();
+}
+
+// size and mtime, empty if the file is missing
+QString ConfigWatcher::fileStamp()
+{
+    QFileInfo info(file);
+    if (!info.exists()) { return QString(); }
+    return QString("%1:%2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+// the settings file is replaced on save, so the file watch
+// must be added again, the directory catches new files.
+void ConfigWatcher::watch()
+{
+    QFileInfo info(file);
+    QString dir = info.absolutePath();
+    if (!watcher->directories().contains(dir) && QFileInfo(dir).exists()) { watcher->addPath(dir); }
+    if (!watcher->files().contains(file) && info.exists()) { watcher->addPath(file); }
+}
+
+void ConfigWatcher::handleChanged()
+{
+    timer->start();
+}
+
+// battery history, display profiles and QSettings lock files live in
+// the same directory, only changes to the settings file count
+void ConfigWatcher::handleDirectoryChanged()
+{
+    if (fileStamp() == stamp) { return; }
+    timer->start();
+}
+
+// the file as it is now is already applied (ApplySettings),
+// a pending reload of the same write is dropped
+void ConfigWatcher::sync()
+{
+    stamp = fileStamp();
+}
+
+void ConfigWatcher::handleTimeout()
+{
+    watch();
+    QString current = fileStamp();
+    if (current == stamp) { return; }
+    stamp = current;
+    emit changed();
+}
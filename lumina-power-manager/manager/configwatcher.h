@@ -0,0 +1,44 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef CONFIGWATCHER_H
+#define CONFIGWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// watch the power settings file (inotify on Linux) and emit
+// changed() once per burst of writes
+class ConfigWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConfigWatcher(const QString &fileName, QObject *parent = NULL);
+    void sync();
+
+private:
+    QString file;
+    QFileSystemWatcher *watcher;
+    QTimer *timer;
+    QString stamp;
+    QString fileStamp();
+
+signals:
+    void changed();
+
+private slots:
+    void watch();
+    void handleChanged();
+    void handleDirectoryChanged();
+    void handleTimeout();
+};
+
+#endif // CONFIGWATCHER_H
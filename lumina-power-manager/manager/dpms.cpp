@@ -0,0 +1,65 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "dpms.h"
+
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+
+Dpms::Dpms(XConnection *connection)
+    : xcon(connection)
+    , capable(false)
+    , wasDisabled(false)
+{
+    if (!xcon->isValid()) { return; }
+    int eventBase, errorBase;
+    if (DPMSQueryExtension(xcon->display(), &eventBase, &errorBase)) { capable = DPMSCapable(xcon->display()); }
+    if (!capable) { qWarning("DPMS is not available, screen off disabled."); }
+}
+
+bool Dpms::isValid()
+{
+    return capable;
+}
+
+bool Dpms::screenOff()
+{
+    return forceLevel(DPMSModeOff);
+}
+
+// the server also wakes the screen on input, this is for other wakeups.
+// DPMS is disabled again if it was disabled before screenOff
+bool Dpms::screenOn()
+{
+    bool result = forceLevel(DPMSModeOn);
+    if (capable && wasDisabled) {
+        DPMSDisable(xcon->display());
+        xcon->flush();
+        wasDisabled = false;
+    }
+    return result;
+}
+
+// DPMS must be enabled for a forced level to stick
+bool Dpms::forceLevel(unsigned short level)
+{
+    if (!capable) { return false; }
+    Display *dpy = xcon->display();
+    CARD16 current;
+    BOOL enabled;
+    if (!DPMSInfo(dpy, &current, &enabled)) { return false; }
+    if (current == level) { return true; }
+    if (!enabled) {
+        DPMSEnable(dpy);
+        wasDisabled = true;
+    }
+    bool result = DPMSForceLevel(dpy, level);
+    xcon->flush();
+    return result;
+}
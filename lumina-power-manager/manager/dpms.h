@@ -0,0 +1,31 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef DPMS_H
+#define DPMS_H
+
+#include "xconnection.h"
+
+// in process DPMS control, no xset needed
+class Dpms
+{
+public:
+    explicit Dpms(XConnection *connection);
+    bool isValid();
+    bool screenOff();
+    bool screenOn();
+
+private:
+    XConnection *xcon;
+    bool capable;
+    bool wasDisabled;
+    bool forceLevel(unsigned short level);
+};
+
+#endif // DPMS_H
@@ -9,103 +9,113 @@
 
 #include "hotplug.h"
 
-HotPlug::HotPlug(QObject *parent) :
+#include <X11/extensions/Xrandr.h>
+
+#define OCNE(X) ((XRROutputChangeNotifyEvent*)X)
+
+HotPlug::HotPlug(XConnection *connection, QObject *parent) :
     QObject(parent)
+  , xcon(connection)
   , _scanning(false)
+  , cache(connection)
+  , pendingEvents(0)
+  , settle(0)
+  , ownTimestamp(0)
 {
-    moveToThread(&t);
-    t.start();
+    // dock/undock sends a burst of output changes, wait for it to settle
+    settle = new QTimer(this);
+    settle->setSingleShot(true);
+    settle->setInterval(HOTPLUG_SETTLE);
+    connect(settle, SIGNAL(timeout()), this, SLOT(handleSettled()));
+
+    connect(xcon, SIGNAL(randrEvent(XEvent*)), this, SLOT(handleEvent(XEvent*)));
 }
 
 HotPlug::~HotPlug()
 {
+    if (!_scanning) { return; }
     _scanning = false;
-    t.wait();
-    t.quit();
+    XRRSelectInput(xcon->display(), xcon->rootWindow(), 0);
+    xcon->flush();
 }
 
 void HotPlug::requestScan()
 {
-    QMetaObject::invokeMethod(this, "scan");
+    scan();
 }
 
 void HotPlug::scan()
 {
+    if (!xcon->isValid() || xcon->randrEventBase()<0) { return; }
     if (_scanning) { return; }
     _scanning = true;
 
-    Display *dpy;
-    if ((dpy = XOpenDisplay(NULL)) == NULL) { return; }
-
-    XRRScreenResources *sr;
-    XRROutputInfo *info;
-    XEvent ev;
-
-    getScreens(dpy);
-
-    XRRSelectInput(dpy, DefaultRootWindow(dpy), RROutputChangeNotifyMask);
-    XSync(dpy, 0);
-    while(_scanning) {
-        if (!XNextEvent(dpy, &ev)) {
-            sr = XRRGetScreenResources(OCNE(&ev)->display, OCNE(&ev)->window);
-            if (sr == NULL) { continue; }
-            info = XRRGetOutputInfo(OCNE(&ev)->display, sr, OCNE(&ev)->output);
-            if (info == NULL) {
-                XRRFreeScreenResources(sr);
-                continue;
-            }
-            QString screenName = info->name;
-            bool screenConnected = false;
-            if (info->connection == RR_Connected) { screenConnected = true; }
-            emit status(screenName, screenConnected);
-            XRRFreeScreenResources(sr);
-            XRRFreeOutputInfo(info);
-        }
+    getScreens();
+
+    XRRSelectInput(xcon->display(), xcon->rootWindow(), RROutputChangeNotifyMask);
+    xcon->flush();
+}
+
+void HotPlug::handleEvent(XEvent *ev)
+{
+    if (!_scanning) { return; }
+    if ((ev->type & 0x7f) != xcon->randrEventBase()+RRNotify) { return; }
+    if (((XRRNotifyEvent*)ev)->subtype != RRNotify_OutputChange) { return; }
+
+    cache.invalidate(OCNE(ev)->output);
+    if (pendingEvents == 0) { burst.start(); }
+    pendingEvents++;
+    settle->start();
+}
+
+// emit the net change since the last settled state,
+// same monitors with new geometry is a layout change,
+// unless the last change was our own apply
+void HotPlug::handleSettled()
+{
+    Topology previous = current;
+    current = cache.snapshot();
+    QMap<QString,bool> result = current.connectionChanges(previous);
+    qDebug() << "hotplug events" << pendingEvents << "changes" << result;
+    int events = pendingEvents;
+    pendingEvents = 0;
+    if (!result.isEmpty()) { emit changed(result, events); }
+    else if (!(current == previous)) {
+        if (ownTimestamp && current.timestamp == ownTimestamp) { return; }
+        emit layoutChanged();
     }
-    XCloseDisplay(dpy);
+}
+
+// msec since the first event of the last burst
+qint64 HotPlug::burstElapsed()
+{
+    if (!burst.isValid()) { return -1; }
+    return burst.elapsed();
+}
+
+// call after applying a layout, the settled burst from it
+// is not reported as a layout change. any later change from
+// another client has a new RandR timestamp
+void HotPlug::ignoreOwnLayout()
+{
+    ownTimestamp = cache.snapshot().timestamp;
+}
+
+// last settled topology
+Topology HotPlug::topology()
+{
+    return current;
 }
 
 void HotPlug::requestSetScan(bool scanning)
 {
-    QMetaObject::invokeMethod(this, "setScan", Q_ARG(bool, scanning));
+    setScan(scanning);
 }
 
-void HotPlug::getScreens(Display *dpy)
+void HotPlug::getScreens()
 {
-    if (dpy == NULL) { return; }
-    QMap<QString,bool> result;
-
-    XRRMonitorInfo *mi;
-    XRRScreenResources *sr;
-    XineramaScreenInfo *si;
-    XRROutputInfo *info;
-    int i, j, k, monitors, screens = -1;
-
-    si = XineramaQueryScreens(dpy, &screens);
-    mi = XRRGetMonitors(dpy, DefaultRootWindow(dpy), True, &monitors);
-    sr = XRRGetScreenResourcesCurrent(dpy, DefaultRootWindow(dpy));
-    if (si && mi) {
-        for (i = 0; i < screens; ++i) {
-            for (j = 0; j < monitors; ++j) {
-                for (k = 0; k < mi[j].noutput; ++k) {
-                    info = XRRGetOutputInfo(dpy, sr, mi[j].outputs[k]);
-                    if (info == NULL) {
-                        continue;
-                        XRRFreeOutputInfo(info);
-                    }
-                    QString screenName = info->name;
-                    bool screenConnected = false;
-                    if (info->connection == RR_Connected) { screenConnected = true; }
-                    result[screenName] = screenConnected;
-                    XRRFreeOutputInfo(info);
-                }
-            }
-        }
-        XFree(si);
-        XRRFreeMonitors(mi);
-    }
-    XRRFreeScreenResources(sr);
-    emit found(result);
+    current = cache.snapshot();
+    emit found(current.connections());
 }
 
 void HotPlug::setScan(bool scanning)
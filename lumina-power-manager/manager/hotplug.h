@@ -11,46 +11,52 @@
 #define HOTPLUG_H
 
 #include <QObject>
-#include <QThread>
 #include <QMap>
 #include <QDebug>
+#include <QTimer>
+#include <QElapsedTimer>
 
-#include <X11/extensions/Xrandr.h>
-#include <X11/extensions/Xinerama.h>
+#include "xconnection.h"
+#include "topology.h"
 
-#undef Bool // fix X11 inc
-
-#define INTERNAL_MONITOR "LVDS"
 #define VIRTUAL_MONITOR "VIRTUAL"
-#define TURN_OFF_MONITOR "xrandr --output %1 --off"
-#define TURN_ON_MONITOR "xrandr --output %1 --auto"
-#define XCONFIG "lumina-xconfig --reset-monitors"
-
-#define OCNE(X) ((XRROutputChangeNotifyEvent*)X)
+#define HOTPLUG_SETTLE 500
 
 class HotPlug : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit HotPlug(QObject *parent = 0);
+    explicit HotPlug(XConnection *connection, QObject *parent = 0);
     ~HotPlug();
+    Topology topology();
+    qint64 burstElapsed();
+    void ignoreOwnLayout();
 
 private:
-    QThread t;
+    XConnection *xcon;
     bool _scanning;
+    TopologyCache cache;
+    Topology current;
+    int pendingEvents;
+    QTimer *settle;
+    QElapsedTimer burst;
+    unsigned long ownTimestamp;
 
 signals:
-    void status(QString display, bool connected);
+    void changed(QMap<QString,bool> displays, int events);
     void found(QMap<QString,bool> devices);
+    void layoutChanged();
 
 public slots:
     void requestScan();
     void requestSetScan(bool scanning);
 private slots:
     void scan();
-    void getScreens(Display *dpy);
+    void getScreens();
     void setScan(bool scanning);
+    void handleEvent(XEvent *ev);
+    void handleSettled();
 };
 
 #endif // HOTPLUG_H
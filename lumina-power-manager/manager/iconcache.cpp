@@ -0,0 +1,94 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "iconcache.h"
+#include "common.h"
+
+#include <QPixmap>
+#include <QPainter>
+
+// icon name for [state][ac]
+static const char *iconNames[][2] = {
+    { DEFAULT_BATTERY_ICON, DEFAULT_BATTERY_ICON },
+    { DEFAULT_BATTERY_ICON_LOW, DEFAULT_BATTERY_ICON_LOW_AC },
+    { DEFAULT_BATTERY_ICON_CRIT, DEFAULT_BATTERY_ICON_CRIT_AC },
+    { DEFAULT_BATTERY_ICON_GOOD, DEFAULT_BATTERY_ICON_GOOD_AC },
+    { DEFAULT_BATTERY_ICON_FULL, DEFAULT_BATTERY_ICON_FULL_AC },
+    { DEFAULT_BATTERY_ICON_FULL, DEFAULT_BATTERY_ICON_CHARGED }
+};
+
+IconCache::IconCache()
+    : theme(QIcon::themeName())
+{
+}
+
+// key layout: state (4 bits), ac (1 bit), percent + 1 (8 bits, 0 is no overlay),
+// device pixel ratio in quarters (8 bits)
+quint32 IconCache::key(State state, bool ac, int percent, qreal dpr)
+{
+    if (percent>100) { percent = 100; }
+    if (percent<0) { percent = -1; }
+    int ratio = qRound(dpr*4);
+    if (ratio<1) { ratio = 1; }
+    if (ratio>255) { ratio = 255; }
+    return ((quint32)state << 17) | ((quint32)(ac?1:0) << 16) | ((quint32)(percent+1) << 8) | (quint32)ratio;
+}
+
+QIcon IconCache::icon(quint32 key)
+{
+    QHash<quint32, QIcon>::const_iterator it = cache.constFind(key);
+    if (it != cache.constEnd()) { return it.value(); }
+    QIcon result = render(key);
+    cache.insert(key, result);
+    return result;
+}
+
+// clear the cache if the icon theme changed
+bool IconCache::themeChanged()
+{
+    QString current = QIcon::themeName();
+    if (current == theme) { return false; }
+    theme = current;
+    cache.clear();
+    return true;
+}
+
+int IconCache::size()
+{
+    return cache.size();
+}
+
+QIcon IconCache::render(quint32 key)
+{
+    int state = (key >> 17) & 0xf;
+    int ac = (key >> 16) & 0x1;
+    int percent = (int)((key >> 8) & 0xff) - 1;
+    if (state>stateCharged) { state = stateDefault; }
+
+    QString name = iconNames[state][ac];
+    QIcon icon = QIcon::fromTheme(name, QIcon(QString(":/icons/%1.png").arg(name)));
+    if (percent<0) { return icon; }
+
+    // render at device pixels, paint the overlay in 24x24 logical pixels
+    qreal dpr = (qreal)(key & 0xff)/4;
+    int side = qRound(24*dpr);
+    QPixmap pixmap = icon.pixmap(QSize(side, side));
+    QRect rect = pixmap.rect();
+#if QT_VERSION >= 0x050000
+    pixmap.setDevicePixelRatio(dpr);
+    rect = QRect(QPoint(0, 0), pixmap.size()/dpr);
+#endif
+    QPainter painter(&pixmap);
+    painter.setPen(QColor(Qt::black));
+    painter.drawText(rect.adjusted(1, 1, 1, 1), Qt::AlignCenter, QString::number(percent));
+    painter.setPen(QColor(Qt::white));
+    painter.drawText(rect, Qt::AlignCenter, QString::number(percent));
+    painter.end();
+    return QIcon(pixmap);
+}
@@ -0,0 +1,46 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QIcon>
+#include <QHash>
+#include <QString>
+
+#define ICON_CACHE_INVALID_KEY 0xffffffff
+
+// rendered battery tray icons, keyed by state, power source,
+// percent overlay and device pixel ratio.
+// the cache is only cleared when the icon theme changes.
+class IconCache
+{
+public:
+    enum State
+    {
+        stateDefault,
+        stateLow,
+        stateCritical,
+        stateGood,
+        stateFull,
+        stateCharged
+    };
+    IconCache();
+    static quint32 key(State state, bool ac, int percent, qreal dpr);
+    QIcon icon(quint32 key);
+    bool themeChanged();
+    int size();
+
+private:
+    QHash<quint32, QIcon> cache;
+    QString theme;
+    QIcon render(quint32 key);
+};
+
+#endif // ICONCACHE_H
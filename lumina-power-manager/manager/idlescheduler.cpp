@@ -0,0 +1,122 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "idlescheduler.h"
+
+#include <QDebug>
+
+IdleScheduler::IdleScheduler(IdleTimer *timer, QObject *parent) :
+    QObject(parent)
+  , idle(timer)
+  , offset(0)
+  , fired(0)
+  , active(0)
+{
+    for (int i=0;i<stageCount;++i) { deadlines[i] = 0; }
+    connect(idle, SIGNAL(idle(qint64)), this, SLOT(handleIdle(qint64)));
+    connect(idle, SIGNAL(resumed()), this, SLOT(handleResumed()));
+}
+
+qint64 IdleScheduler::stage(Stage stage)
+{
+    return deadlines[stage];
+}
+
+// bit mask of stages reached since the last user activity
+int IdleScheduler::activeStages()
+{
+    return active;
+}
+
+// set stage deadline in idle msec, 0 disables the stage
+void IdleScheduler::setStage(int stage, qint64 msec)
+{
+    if (stage<0 || stage>=stageCount) { return; }
+    if (msec<0) { msec = 0; }
+    if (deadlines[stage] == msec) { return; }
+
+    qint64 old = deadlines[stage];
+    if (old>0) {
+        int stages = queue.value(old) & ~(1<<stage);
+        if (stages) { queue.insert(old, stages); }
+        else { queue.remove(old); }
+    }
+    deadlines[stage] = msec;
+    if (msec>0) { queue.insert(msec, queue.value(msec) | (1<<stage)); }
+
+    // the first deadline is the idle timeout. past it or after a
+    // restart, only the next deadline is armed (from the offset),
+    // the timeout is kept for user activity
+    qint64 first = queue.isEmpty()?0:queue.constBegin().key();
+    if ((fired>0 || offset>0) && first>0) {
+        idle->setTimeout(first, false);
+        arm();
+    } else { idle->setTimeout(first); }
+}
+
+// user activity without input (SimulateUserActivity), start over from
+// the current idle time
+void IdleScheduler::restart()
+{
+    int stages = active;
+    offset = idle->idleTime();
+    fired = 0;
+    active = 0;
+    idle->restart();
+    if (stages) { emit resumed(stages); }
+}
+
+// run stages again after a full timeout from now (they were inhibited),
+// the other reached stages stay active
+void IdleScheduler::retry(int stages)
+{
+    active &= ~stages;
+    offset = idle->idleTime();
+    fired = 0;
+    idle->restart();
+}
+
+// arm the first deadline after the ones already fired
+void IdleScheduler::arm()
+{
+    QMap<qint64, int>::const_iterator next = queue.upperBound(fired);
+    if (next == queue.constEnd()) { return; }
+    idle->setDeadline(offset+next.key());
+}
+
+// value is the idle time of the alarm
+void IdleScheduler::handleIdle(qint64 value)
+{
+    // collect first, the stage handlers may change the queue
+    qint64 now = value-offset;
+    int stages = 0;
+    QMap<qint64, int>::const_iterator i = queue.upperBound(fired);
+    while (i != queue.constEnd() && i.key() <= now) {
+        stages |= i.value();
+        fired = i.key();
+        ++i;
+    }
+    arm();
+
+    for (int stage=0;stage<stageCount;++stage) {
+        if (!(stages & (1<<stage)) || (active & (1<<stage))) { continue; }
+        qDebug() << "idle stage" << stage << "at" << now << "ms";
+        active |= 1<<stage;
+        emit stageReached(stage);
+    }
+}
+
+void IdleScheduler::handleResumed()
+{
+    int stages = active;
+    offset = 0;
+    fired = 0;
+    active = 0;
+    emit resumed(stages);
+}
@@ -0,0 +1,62 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef IDLESCHEDULER_H
+#define IDLESCHEDULER_H
+
+#include <QObject>
+#include <QMap>
+
+#include "idletimer.h"
+
+// idle stages on one deadline queue (idle msec -> stages), only the
+// nearest deadline is armed on the idle timer. user activity
+// goes back to the first deadline.
+class IdleScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Stage
+    {
+        stageDim,
+        stageScreenOff,
+        stageLock,
+        stageSuspend,
+        stageCount
+    };
+
+    explicit IdleScheduler(IdleTimer *timer, QObject *parent = NULL);
+    qint64 stage(Stage stage);
+    int activeStages();
+
+private:
+    IdleTimer *idle;
+    qint64 deadlines[stageCount];
+    QMap<qint64, int> queue;
+    qint64 offset;
+    qint64 fired;
+    int active;
+    void arm();
+
+signals:
+    void stageReached(int stage);
+    void resumed(int stages);
+
+public slots:
+    void setStage(int stage, qint64 msec);
+    void restart();
+    void retry(int stages);
+
+private slots:
+    void handleIdle(qint64 value);
+    void handleResumed();
+};
+
+#endif // IDLESCHEDULER_H
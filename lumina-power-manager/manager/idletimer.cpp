@@ -0,0 +1,194 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "idletimer.h"
+
+#include <QDebug>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/sync.h>
+
+static XSyncValue toSyncValue(qint64 value)
+{
+    XSyncValue result;
+    XSyncIntsToValue(&result, (unsigned int)(value & 0xffffffff), (int)(value >> 32));
+    return result;
+}
+
+static qint64 fromSyncValue(XSyncValue value)
+{
+    return ((qint64)XSyncValueHigh32(value) << 32) | (qint64)XSyncValueLow32(value);
+}
+
+IdleTimer::IdleTimer(XConnection *connection, QObject *parent) :
+    QObject(parent)
+  , xcon(connection)
+  , counter(0)
+  , idleAlarm(0)
+  , resetAlarm(0)
+  , idleValue(0)
+  , msec(0)
+{
+    if (!xcon || !xcon->isValid()) { return; }
+    if (xcon->syncEventBase()<0) {
+        qWarning("XSync extension is not available, auto sleep disabled.");
+        return;
+    }
+
+    // find the idle time counter
+    int ncounters = 0;
+    XSyncSystemCounter *counters = XSyncListSystemCounters(xcon->display(), &ncounters);
+    for (int i=0;i<ncounters;++i) {
+        if (qstrcmp(counters[i].name, "IDLETIME") == 0) {
+            counter = counters[i].counter;
+            break;
+        }
+    }
+    if (counters) { XSyncFreeSystemCounterList(counters); }
+    if (!counter) {
+        qWarning("XSync IDLETIME counter is not available, auto sleep disabled.");
+        return;
+    }
+
+    connect(xcon, SIGNAL(syncEvent(XEvent*)), this, SLOT(handleEvent(XEvent*)));
+}
+
+IdleTimer::~IdleTimer()
+{
+    if (!isValid()) { return; }
+    destroyAlarm(&idleAlarm);
+    destroyAlarm(&resetAlarm);
+    xcon->flush();
+}
+
+bool IdleTimer::isValid()
+{
+    return xcon && xcon->isValid() && counter != 0;
+}
+
+// current idle time in msec
+qint64 IdleTimer::idleTime()
+{
+    if (!isValid()) { return 0; }
+    XSyncValue value;
+    XRoundTrip trip(xcon);
+    if (!XSyncQueryCounter(xcon->display(), counter, &value)) { return 0; }
+    return fromSyncValue(value);
+}
+
+qint64 IdleTimer::timeout()
+{
+    return msec;
+}
+
+// idle time the alarm is armed at
+qint64 IdleTimer::deadline()
+{
+    return idleValue;
+}
+
+// set idle timeout in msec, 0 disables the timer.
+// without rearm the armed deadline is kept
+void IdleTimer::setTimeout(qint64 value, bool rearm)
+{
+    if (!rearm && value>0) {
+        msec = value;
+        return;
+    }
+    if (value == msec && (idleAlarm || value <= 0)) { return; }
+    msec = value;
+    arm(msec);
+}
+
+// wait for a full timeout from the current idle time,
+// falls back to the normal timeout on user activity
+void IdleTimer::restart()
+{
+    if (!isValid() || msec <= 0) { return; }
+    arm(idleTime() + msec);
+}
+
+// arm at a later idle time, user activity falls back to the timeout
+void IdleTimer::setDeadline(qint64 value)
+{
+    if (!isValid() || msec <= 0) { return; }
+    arm(value);
+}
+
+void IdleTimer::arm(qint64 value)
+{
+    if (!isValid()) { return; }
+    if (msec <= 0) {
+        destroyAlarm(&idleAlarm);
+        destroyAlarm(&resetAlarm);
+        xcon->flush();
+        return;
+    }
+
+    // a transition alarm below the current idle time would never trigger
+    qint64 current = idleTime();
+    if (value <= current) { value = current + 1; }
+    idleValue = value;
+    setAlarm(&idleAlarm, idleValue, true);
+
+    // deadline is later than the timeout, get back to it on user activity
+    if (idleValue > msec && current > 0) { setAlarm(&resetAlarm, current, false); }
+    else { destroyAlarm(&resetAlarm); }
+    xcon->flush();
+}
+
+void IdleTimer::setAlarm(unsigned long *alarm, qint64 value, bool positive)
+{
+    XSyncAlarmAttributes attr;
+    attr.trigger.counter = counter;
+    attr.trigger.value_type = XSyncAbsolute;
+    attr.trigger.test_type = positive?XSyncPositiveTransition:XSyncNegativeTransition;
+    attr.trigger.wait_value = toSyncValue(value);
+    XSyncIntToValue(&attr.delta, 0);
+    unsigned long flags = XSyncCACounter|XSyncCAValueType|XSyncCATestType|XSyncCAValue|XSyncCADelta;
+    if (*alarm) { XSyncChangeAlarm(xcon->display(), *alarm, flags, &attr); }
+    else { *alarm = XSyncCreateAlarm(xcon->display(), flags, &attr); }
+}
+
+void IdleTimer::destroyAlarm(unsigned long *alarm)
+{
+    if (!*alarm) { return; }
+    XSyncDestroyAlarm(xcon->display(), *alarm);
+    *alarm = 0;
+}
+
+void IdleTimer::handleEvent(XEvent *ev)
+{
+    if (ev->type != xcon->syncEventBase()+XSyncAlarmNotify) { return; }
+    XSyncAlarmNotifyEvent *alarmEvent = (XSyncAlarmNotifyEvent*)ev;
+    if (alarmEvent->state == XSyncAlarmDestroyed) { return; }
+    if (alarmEvent->alarm == idleAlarm) {
+        // sent before the alarm was moved, the new deadline is still ahead
+        if (fromSyncValue(alarmEvent->alarm_value) != idleValue) { return; }
+        handleIdle(fromSyncValue(alarmEvent->counter_value));
+    }
+    else if (alarmEvent->alarm == resetAlarm) { handleReset(); }
+}
+
+// idle deadline reached, watch for user activity
+void IdleTimer::handleIdle(qint64 value)
+{
+    setAlarm(&resetAlarm, value, false);
+    xcon->flush();
+    emit idle(value);
+}
+
+// user activity after idle or restart
+void IdleTimer::handleReset()
+{
+    destroyAlarm(&resetAlarm);
+    if (idleValue != msec) { arm(msec); }
+    else { xcon->flush(); }
+    emit resumed();
+}
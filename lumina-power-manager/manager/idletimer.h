@@ -0,0 +1,59 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef IDLETIMER_H
+#define IDLETIMER_H
+
+#include <QObject>
+
+#include "xconnection.h"
+
+// user idle timer using the XSync IDLETIME system counter.
+// the X server tells us when the idle deadline is reached and when
+// the user is back, so we never need to poll.
+// without a connection the timer does nothing, tests override it
+class IdleTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IdleTimer(XConnection *connection, QObject *parent = NULL);
+    ~IdleTimer();
+    bool isValid();
+    virtual qint64 idleTime();
+    qint64 timeout();
+    qint64 deadline();
+
+private:
+    XConnection *xcon;
+    unsigned long counter;
+    unsigned long idleAlarm;
+    unsigned long resetAlarm;
+    qint64 idleValue;
+    qint64 msec;
+    void arm(qint64 value);
+    void setAlarm(unsigned long *alarm, qint64 value, bool positive);
+    void destroyAlarm(unsigned long *alarm);
+
+signals:
+    void idle(qint64 value);
+    void resumed();
+
+public slots:
+    virtual void setTimeout(qint64 value, bool rearm = true);
+    virtual void restart();
+    virtual void setDeadline(qint64 value);
+
+private slots:
+    void handleEvent(XEvent *ev);
+    void handleIdle(qint64 value);
+    void handleReset();
+};
+
+#endif // IDLETIMER_H
@@ -0,0 +1,220 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "inhibitregistry.h"
+#include "tracering.h"
+
+#include <QDBusConnection>
+#include <QDebug>
+
+#include <limits.h>
+
+InhibitRegistry::InhibitRegistry(QObject *parent) :
+    QObject(parent)
+  , lastCookie(0)
+  , timeout(0)
+  , timer(0)
+  , watcher(0)
+{
+    for (int i=0;i<kindCount;++i) { counts[i] = 0; }
+    clock.start();
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+
+    // owners are watched while they hold an inhibitor
+    watcher = new QDBusServiceWatcher(this);
+    watcher->setConnection(QDBusConnection::sessionBus());
+    watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(watcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(handleOwnerGone(QString)));
+}
+
+// add inhibitor, returns the cookie (never 0)
+quint32 InhibitRegistry::inhibit(Kind kind, const QString &owner, const QString &application, const QString &reason)
+{
+    bool wasInhibited = hasInhibit();
+    do { lastCookie++; } while (lastCookie == 0 || inhibitors.contains(lastCookie));
+
+    Inhibitor inhibitor;
+    inhibitor.cookie = lastCookie;
+    inhibitor.kind = kind;
+    inhibitor.owner = owner;
+    inhibitor.application = application;
+    inhibitor.reason = reason;
+    inhibitor.since = clock.elapsed();
+    if (timeout>0) {
+        inhibitor.expires = inhibitor.since+timeout;
+        deadlines.insert(inhibitor.expires, inhibitor.cookie);
+    }
+    inhibitors.insert(inhibitor.cookie, inhibitor);
+    if (!owner.isEmpty()) {
+        if (!owners.contains(owner)) { watcher->addWatchedService(owner); }
+        owners[owner].insert(inhibitor.cookie);
+    }
+    arm();
+
+    counts[kind]++;
+    TraceRing::record(tracePowerInhibitAdd, (qint32)inhibitor.cookie, kind, (qint32)qHash(owner));
+    qDebug() << "inhibit" << kindName(kind) << inhibitor.cookie << application << reason << owner;
+    if (counts[kind] == 1) { emit changed(kind, true); }
+    if (!wasInhibited) { emit hasInhibitChanged(true); }
+    return inhibitor.cookie;
+}
+
+// only the owner can remove its inhibitors (empty is a local call)
+bool InhibitRegistry::uninhibit(Kind kind, quint32 cookie, const QString &owner)
+{
+    QHash<quint32, Inhibitor>::const_iterator i = inhibitors.constFind(cookie);
+    if (i == inhibitors.constEnd() || i.value().kind != kind) { return false; }
+    if (!owner.isEmpty() && !i.value().owner.isEmpty() && owner != i.value().owner) {
+        qWarning() << owner << "can't remove inhibitor" << cookie << "owned by" << i.value().owner;
+        return false;
+    }
+    remove(cookie);
+    return true;
+}
+
+bool InhibitRegistry::hasInhibit() const
+{
+    return inhibitors.size()>0;
+}
+
+bool InhibitRegistry::hasInhibit(Kind kind) const
+{
+    if (kind<0 || kind>=kindCount) { return false; }
+    return counts[kind]>0;
+}
+
+int InhibitRegistry::size() const
+{
+    return inhibitors.size();
+}
+
+// max time an inhibitor is held in msec, 0 is until released.
+// applies to inhibitors already held
+void InhibitRegistry::setTimeout(qint64 msec)
+{
+    if (msec<0) { msec = 0; }
+    if (msec == timeout) { return; }
+    timeout = msec;
+    deadlines.clear();
+    QHash<quint32, Inhibitor>::iterator i = inhibitors.begin();
+    while (i != inhibitors.end()) {
+        i.value().expires = timeout>0?i.value().since+timeout:0;
+        if (timeout>0) { deadlines.insert(i.value().expires, i.key()); }
+        ++i;
+    }
+    arm();
+}
+
+// cookie, kind, owner, application, reason, held and left (seconds, -1 is no timeout)
+QVariantList InhibitRegistry::toList() const
+{
+    QVariantList result;
+    qint64 now = clock.elapsed();
+    QHash<quint32, Inhibitor>::const_iterator i = inhibitors.constBegin();
+    while (i != inhibitors.constEnd()) {
+        const Inhibitor &inhibitor = i.value();
+        QVariantMap item;
+        item["cookie"] = inhibitor.cookie;
+        item["kind"] = kindName(inhibitor.kind);
+        item["owner"] = inhibitor.owner;
+        item["application"] = inhibitor.application;
+        item["reason"] = inhibitor.reason;
+        item["held"] = (now-inhibitor.since)/1000;
+        item["left"] = inhibitor.expires>0?qMax((qint64)0, (inhibitor.expires-now)/1000):-1;
+        result << item;
+        ++i;
+    }
+    return result;
+}
+
+const char *InhibitRegistry::kindName(int kind)
+{
+    switch(kind) {
+    case kindSleep: return "sleep";
+    case kindScreenSaver: return "screensaver";
+    default: ;
+    }
+    return "unknown";
+}
+
+void InhibitRegistry::remove(quint32 cookie)
+{
+    QHash<quint32, Inhibitor>::iterator i = inhibitors.find(cookie);
+    if (i == inhibitors.end()) { return; }
+    Inhibitor inhibitor = i.value();
+    inhibitors.erase(i);
+
+    if (inhibitor.expires>0) {
+        QMultiMap<qint64, quint32>::iterator deadline = deadlines.find(inhibitor.expires);
+        while (deadline != deadlines.end() && deadline.key() == inhibitor.expires) {
+            if (deadline.value() == cookie) {
+                deadlines.erase(deadline);
+                break;
+            }
+            ++deadline;
+        }
+        arm();
+    }
+    if (!inhibitor.owner.isEmpty()) {
+        QHash<QString, QSet<quint32> >::iterator owner = owners.find(inhibitor.owner);
+        if (owner != owners.end()) {
+            owner.value().remove(cookie);
+            if (owner.value().isEmpty()) {
+                owners.erase(owner);
+                watcher->removeWatchedService(inhibitor.owner);
+            }
+        }
+    }
+
+    counts[inhibitor.kind]--;
+    TraceRing::record(tracePowerInhibitRemove, (qint32)cookie, inhibitor.kind, (qint32)((clock.elapsed()-inhibitor.since)/1000));
+    qDebug() << "uninhibit" << kindName(inhibitor.kind) << cookie << inhibitor.application;
+    if (counts[inhibitor.kind] == 0) { emit changed(inhibitor.kind, false); }
+    if (!hasInhibit()) { emit hasInhibitChanged(false); }
+}
+
+// single shot for the nearest expiry
+void InhibitRegistry::arm()
+{
+    if (deadlines.isEmpty()) {
+        timer->stop();
+        return;
+    }
+    qint64 left = deadlines.constBegin().key()-clock.elapsed();
+    timer->start((int)qBound((qint64)0, left, (qint64)INT_MAX));
+}
+
+// client left the bus (or crashed) without UnInhibit
+void InhibitRegistry::handleOwnerGone(const QString &owner)
+{
+    if (!owners.contains(owner)) { return; }
+    QList<quint32> cookies = owners.value(owner).values();
+    qDebug() << "inhibitor owner gone" << owner << cookies;
+    for (int i=0;i<cookies.size();++i) { remove(cookies.at(i)); }
+}
+
+void InhibitRegistry::handleTimeout()
+{
+    // collect first, remove() changes the queue
+    qint64 now = clock.elapsed();
+    QList<quint32> expired;
+    QMultiMap<qint64, quint32>::const_iterator i = deadlines.constBegin();
+    while (i != deadlines.constEnd() && i.key() <= now) {
+        expired << i.value();
+        ++i;
+    }
+    for (int j=0;j<expired.size();++j) {
+        qDebug() << "inhibitor expired" << expired.at(j);
+        remove(expired.at(j));
+    }
+    arm();
+}
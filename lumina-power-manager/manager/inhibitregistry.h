@@ -0,0 +1,90 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef INHIBITREGISTRY_H
+#define INHIBITREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QTimer>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDBusServiceWatcher>
+
+// one inhibitor, owner is the unique bus name of the client
+struct Inhibitor
+{
+    quint32 cookie;
+    int kind;
+    QString owner;
+    QString application;
+    QString reason;
+    qint64 since;
+    qint64 expires;
+
+    Inhibitor()
+        : cookie(0)
+        , kind(0)
+        , since(0)
+        , expires(0)
+    {
+    }
+};
+
+// inhibitors from org.freedesktop.PowerManagement and org.freedesktop.ScreenSaver.
+// entries are keyed by cookie and indexed by owner, they are dropped when
+// the owner leaves the bus or when the timeout runs out (0 is no timeout).
+// hasInhibit() is a counter lookup.
+class InhibitRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind
+    {
+        kindSleep,
+        kindScreenSaver,
+        kindCount
+    };
+
+    explicit InhibitRegistry(QObject *parent = NULL);
+    quint32 inhibit(Kind kind, const QString &owner, const QString &application, const QString &reason);
+    bool uninhibit(Kind kind, quint32 cookie, const QString &owner);
+    bool hasInhibit() const;
+    bool hasInhibit(Kind kind) const;
+    int size() const;
+    void setTimeout(qint64 msec);
+    QVariantList toList() const;
+    static const char *kindName(int kind);
+
+private:
+    QHash<quint32, Inhibitor> inhibitors;
+    QHash<QString, QSet<quint32> > owners;
+    QMultiMap<qint64, quint32> deadlines;
+    int counts[kindCount];
+    quint32 lastCookie;
+    qint64 timeout;
+    QElapsedTimer clock;
+    QTimer *timer;
+    QDBusServiceWatcher *watcher;
+    void remove(quint32 cookie);
+    void arm();
+
+signals:
+    void changed(int kind, bool inhibited);
+    void hasInhibitChanged(bool inhibited);
+
+private slots:
+    void handleOwnerGone(const QString &owner);
+    void handleTimeout();
+};
+
+#endif // INHIBITREGISTRY_H
@@ -0,0 +1,87 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "inhibitservice.h"
+
+#include <QDBusMessage>
+
+// unique bus name of the caller, empty for local calls
+static QString caller(const QDBusContext *context)
+{
+    if (!context->calledFromDBus()) { return QString(); }
+    return context->message().service();
+}
+
+PowerManagementService::PowerManagementService(InhibitRegistry *inhibitors, QObject *parent) :
+    QObject(parent)
+  , registry(inhibitors)
+{
+    connect(registry, SIGNAL(changed(int,bool)), this, SLOT(handleChanged(int,bool)));
+}
+
+void PowerManagementService::handleChanged(int kind, bool inhibited)
+{
+    if (kind != InhibitRegistry::kindSleep) { return; }
+    emit HasInhibitChanged(inhibited);
+}
+
+quint32 PowerManagementService::Inhibit(const QString &application, const QString &reason)
+{
+    return registry->inhibit(InhibitRegistry::kindSleep, caller(this), application, reason);
+}
+
+void PowerManagementService::UnInhibit(quint32 cookie)
+{
+    registry->uninhibit(InhibitRegistry::kindSleep, cookie, caller(this));
+}
+
+bool PowerManagementService::HasInhibit()
+{
+    return registry->hasInhibit(InhibitRegistry::kindSleep);
+}
+
+// application names, see Inhibitors() on org.lumina.PowerManager for details
+QStringList PowerManagementService::GetInhibitors()
+{
+    QStringList result;
+    QVariantList list = registry->toList();
+    for (int i=0;i<list.size();++i) {
+        QVariantMap inhibitor = list.at(i).toMap();
+        if (inhibitor.value("kind").toString() != InhibitRegistry::kindName(InhibitRegistry::kindSleep)) { continue; }
+        result << inhibitor.value("application").toString();
+    }
+    return result;
+}
+
+// settings changed (old settings dialog)
+void PowerManagementService::refresh()
+{
+    emit update();
+}
+
+ScreenSaverService::ScreenSaverService(InhibitRegistry *inhibitors, QObject *parent) :
+    QObject(parent)
+  , registry(inhibitors)
+{
+}
+
+quint32 ScreenSaverService::Inhibit(const QString &application, const QString &reason)
+{
+    return registry->inhibit(InhibitRegistry::kindScreenSaver, caller(this), application, reason);
+}
+
+void ScreenSaverService::UnInhibit(quint32 cookie)
+{
+    registry->uninhibit(InhibitRegistry::kindScreenSaver, cookie, caller(this));
+}
+
+void ScreenSaverService::SimulateUserActivity()
+{
+    emit userActivity();
+}
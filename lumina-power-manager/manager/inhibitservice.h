@@ -0,0 +1,67 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef INHIBITSERVICE_H
+#define INHIBITSERVICE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QDBusContext>
+
+#include "inhibitregistry.h"
+
+// org.freedesktop.PowerManagement, sleep inhibitors go to the registry
+class PowerManagementService : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.PowerManagement")
+
+public:
+    explicit PowerManagementService(InhibitRegistry *inhibitors, QObject *parent = NULL);
+
+private:
+    InhibitRegistry *registry;
+
+signals:
+    void HasInhibitChanged(bool has_inhibit);
+    void update();
+
+private slots:
+    void handleChanged(int kind, bool inhibited);
+
+public slots:
+    quint32 Inhibit(const QString &application, const QString &reason);
+    void UnInhibit(quint32 cookie);
+    bool HasInhibit();
+    QStringList GetInhibitors();
+    void refresh();
+};
+
+// org.freedesktop.ScreenSaver, screensaver inhibitors go to the registry
+class ScreenSaverService : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.ScreenSaver")
+
+public:
+    explicit ScreenSaverService(InhibitRegistry *inhibitors, QObject *parent = NULL);
+
+private:
+    InhibitRegistry *registry;
+
+signals:
+    void userActivity();
+
+public slots:
+    quint32 Inhibit(const QString &application, const QString &reason);
+    void UnInhibit(quint32 cookie);
+    void SimulateUserActivity();
+};
+
+#endif // INHIBITSERVICE_H
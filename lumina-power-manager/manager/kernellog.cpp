@@ -0,0 +1,79 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "kernellog.h"
+
+#include <QFile>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+KernelLog::KernelLog(const QString &fileName)
+    : path(fileName)
+    , fd(-1)
+{
+}
+
+KernelLog::~KernelLog()
+{
+    close();
+}
+
+// skip what is already logged, lines() returns the rest
+bool KernelLog::mark()
+{
+    close();
+    fd = open(QFile::encodeName(path).constData(), O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+    if (fd<0) { return false; }
+    lseek(fd, 0, SEEK_END);
+    return true;
+}
+
+// one record per read, "prio,seq,usec,flags;message".
+// records overwritten since mark() (EPIPE) are skipped
+QStringList KernelLog::lines()
+{
+    QStringList result;
+    if (fd<0) { return result; }
+    char buffer[8192];
+    while (true) {
+        ssize_t size = read(fd, buffer, sizeof(buffer)-1);
+        if (size<0 && errno == EPIPE) { continue; }
+        if (size<=0) { break; }
+        buffer[size] = '\0';
+        QString record = QString::fromLocal8Bit(buffer, size);
+        int message = record.indexOf(';');
+        result << record.mid(message+1).section('\n', 0, 0);
+    }
+    return result;
+}
+
+void KernelLog::close()
+{
+    if (fd<0) { return; }
+    ::close(fd);
+    fd = -1;
+}
+
+// seconds from "PM: [hibernation: ]Wrote 1234 kbytes in 5.67 seconds (...)",
+// -1 if the line is something else
+double KernelLog::imageWriteTime(const QString &line)
+{
+    int wrote = line.indexOf("Wrote ");
+    if (wrote<0) { return -1; }
+    int in = line.indexOf(" kbytes in ", wrote);
+    int seconds = line.indexOf(" seconds", in);
+    if (in<0 || seconds<0) { return -1; }
+    in += 11;
+    bool ok = false;
+    double result = line.mid(in, seconds-in).toDouble(&ok);
+    if (!ok || result<0) { return -1; }
+    return result;
+}
@@ -0,0 +1,36 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef KERNELLOG_H
+#define KERNELLOG_H
+
+#include <QString>
+#include <QStringList>
+
+#define KERNEL_LOG "/dev/kmsg"
+
+// kernel messages logged after mark(), used to read
+// the hibernate image write time on resume.
+// unreadable with dmesg_restrict, lines() is then empty
+class KernelLog
+{
+public:
+    explicit KernelLog(const QString &fileName = KERNEL_LOG);
+    ~KernelLog();
+    bool mark();
+    QStringList lines();
+    void close();
+    static double imageWriteTime(const QString &line);
+
+private:
+    QString path;
+    int fd;
+};
+
+#endif // KERNELLOG_H
@@ -0,0 +1,121 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "latencytrace.h"
+
+#include <QVariantList>
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram()
+    : count(0)
+    , sum(0)
+    , max(0)
+{
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void LatencyHistogram::add(qint64 usec)
+{
+    if (usec<0) { usec = 0; }
+    int bucket = 0;
+    while (bucket<LATENCY_BUCKETS-1 && (usec>>(bucket+1))) { bucket++; }
+    buckets[bucket]++;
+    count++;
+    sum += usec;
+    if (usec>max) { max = usec; }
+}
+
+// bucket n counts samples below 2^(n+1) usec
+QVariantMap LatencyHistogram::toMap() const
+{
+    QVariantMap result;
+    QVariantList list;
+    for (int i=0;i<LATENCY_BUCKETS;++i) { list << buckets[i]; }
+    result["buckets"] = list;
+    result["count"] = count;
+    result["sum_us"] = sum;
+    result["max_us"] = max;
+    return result;
+}
+
+LatencyTrace::LatencyTrace()
+    : active(false)
+    , sleepAt(-1)
+{
+}
+
+// start of the path (lid signal received), a path still
+// running from an earlier begin() is dropped
+void LatencyTrace::begin()
+{
+    timer.start();
+    active = true;
+    sleepAt = -1;
+}
+
+void LatencyTrace::mark(Point point)
+{
+    if (!active || point<0 || point>=pointCount) { return; }
+    qint64 now = timer.nsecsElapsed()/1000;
+    if (point == pointResume) {
+        if (sleepAt>=0) { histograms[point].add(now-sleepAt); }
+        return;
+    }
+    // the request failed or was inhibited, this sleep is not ours
+    if (sleepAt<0 && now>LATENCY_TRACE_TIMEOUT) {
+        end();
+        return;
+    }
+    if (point == pointSleep) { sleepAt = now; }
+    histograms[point].add(now);
+}
+
+void LatencyTrace::end()
+{
+    active = false;
+    sleepAt = -1;
+}
+
+// the path ends before sleep (lid opened again)
+void LatencyTrace::cancel()
+{
+    if (sleepAt<0) { end(); }
+}
+
+bool LatencyTrace::isActive() const
+{
+    return active;
+}
+
+const LatencyHistogram &LatencyTrace::histogram(Point point) const
+{
+    return histograms[point];
+}
+
+const char *LatencyTrace::pointName(Point point)
+{
+    switch(point) {
+    case pointDecision: return "decision";
+    case pointLock: return "lock";
+    case pointSuspend: return "suspend";
+    case pointSleep: return "sleep";
+    case pointResume: return "resume";
+    default: ;
+    }
+    return "unknown";
+}
+
+QVariantMap LatencyTrace::toMap() const
+{
+    QVariantMap result;
+    for (int i=0;i<pointCount;++i) {
+        result[pointName((Point)i)] = histograms[i].toMap();
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef LATENCYTRACE_H
+#define LATENCYTRACE_H
+
+#include <QElapsedTimer>
+#include <QVariant>
+
+// log2 buckets in usec, the last bucket holds everything above
+#define LATENCY_BUCKETS 25
+// usec, a path that has not reached sleep by then is dropped
+#define LATENCY_TRACE_TIMEOUT 60000000
+
+struct LatencyHistogram
+{
+    quint32 buckets[LATENCY_BUCKETS];
+    quint32 count;
+    qint64 sum;
+    qint64 max;
+
+    LatencyHistogram();
+    void add(qint64 usec);
+    QVariantMap toMap() const;
+};
+
+// timestamped tracepoints for one path (lid close to resume),
+// each point records the time since begin() into its histogram,
+// resume records the time since sleep
+class LatencyTrace
+{
+public:
+    enum Point
+    {
+        pointDecision,
+        pointLock,
+        pointSuspend,
+        pointSleep,
+        pointResume,
+        pointCount
+    };
+
+    LatencyTrace();
+    void begin();
+    void mark(Point point);
+    void end();
+    void cancel();
+    bool isActive() const;
+    const LatencyHistogram &histogram(Point point) const;
+    static const char *pointName(Point point);
+    QVariantMap toMap() const;
+
+private:
+    QElapsedTimer timer;
+    bool active;
+    qint64 sleepAt;
+    LatencyHistogram histograms[pointCount];
+};
+
+#endif // LATENCYTRACE_H
@@ -0,0 +1,369 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "layout.h"
+#include "topology.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QDebug>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
+
+static bool applyFailed = false;
+
+// output to crtc assignment used by apply
+struct CrtcPlan
+{
+    RROutput output;
+    RRCrtc crtc;
+    RRMode mode;
+    int x;
+    int y;
+    Rotation rotation;
+    XRROutputInfo *info;
+};
+
+// crtc config before apply, for the rollback
+struct CrtcSaved
+{
+    RRCrtc crtc;
+    RRMode mode;
+    int x;
+    int y;
+    Rotation rotation;
+    QList<RROutput> outputs;
+};
+
+// crtc config errors are expected (unsupported mode etc), don't let Xlib exit
+static int handleApplyError(Display *dpy, XErrorEvent *ev)
+{
+    Q_UNUSED(dpy)
+    Q_UNUSED(ev)
+    applyFailed = true;
+    return 0;
+}
+
+// refresh rate in mHz
+static int modeRefresh(const XRRModeInfo *mode)
+{
+    double vTotal = mode->vTotal;
+    if (mode->modeFlags & RR_DoubleScan) { vTotal *= 2; }
+    if (mode->modeFlags & RR_Interlace) { vTotal /= 2; }
+    if (mode->hTotal == 0 || vTotal == 0) { return 0; }
+    return qRound((double)mode->dotClock*1000.0/((double)mode->hTotal*vTotal));
+}
+
+static const XRRModeInfo *findMode(XRRScreenResources *sr, RRMode id)
+{
+    for (int i=0;i<sr->nmode;++i) {
+        if (sr->modes[i].id == id) { return &sr->modes[i]; }
+    }
+    return NULL;
+}
+
+// mode for output matching size, closest refresh wins, preferred mode if size is empty
+static RRMode resolveMode(XRRScreenResources *sr, XRROutputInfo *info, const QSize &size, int refresh)
+{
+    if (info->nmode == 0) { return None; }
+    if (size.isEmpty()) { return info->modes[0]; }
+    RRMode result = None;
+    int best = -1;
+    for (int i=0;i<info->nmode;++i) {
+        const XRRModeInfo *mode = findMode(sr, info->modes[i]);
+        if (mode == NULL || (int)mode->width != size.width() || (int)mode->height != size.height()) { continue; }
+        int diff = refresh>0?qAbs(modeRefresh(mode)-refresh):0;
+        if (best<0 || diff<best) {
+            best = diff;
+            result = mode->id;
+        }
+    }
+    return result;
+}
+
+// back to the crtcs and screen size from before apply
+static void restoreCrtcs(Display *dpy, Window root, XRRScreenResources *sr, const QList<CrtcSaved> &saved,
+                         int width, int height, int mmWidth, int mmHeight)
+{
+    for (int i=0;i<sr->ncrtc;++i) { XRRSetCrtcConfig(dpy, sr, sr->crtcs[i], CurrentTime, 0, 0, None, RR_Rotate_0, NULL, 0); }
+    XRRSetScreenSize(dpy, root, width, height, mmWidth, mmHeight);
+    for (int i=0;i<saved.size();++i) {
+        const CrtcSaved &crtc = saved.at(i);
+        QVector<RROutput> outputs = crtc.outputs.toVector();
+        XRRSetCrtcConfig(dpy, sr, crtc.crtc, CurrentTime, crtc.x, crtc.y, crtc.mode, crtc.rotation,
+                         outputs.data(), outputs.size());
+    }
+}
+
+static bool isRotated(int rotation)
+{
+    return rotation & (RR_Rotate_90|RR_Rotate_270);
+}
+
+bool DisplayLayout::isEmpty() const
+{
+    QMapIterator<QString, LayoutOutput> i(outputs);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().enabled) { return false; }
+    }
+    return true;
+}
+
+// bounding box of enabled outputs
+QSize DisplayLayout::screenSize() const
+{
+    int width = 0;
+    int height = 0;
+    QMapIterator<QString, LayoutOutput> i(outputs);
+    while (i.hasNext()) {
+        i.next();
+        const LayoutOutput &output = i.value();
+        if (!output.enabled) { continue; }
+        QSize size = isRotated(output.rotation)?QSize(output.size.height(), output.size.width()):output.size;
+        width = qMax(width, output.pos.x()+size.width());
+        height = qMax(height, output.pos.y()+size.height());
+    }
+    return QSize(width, height);
+}
+
+LayoutEngine::LayoutEngine(XConnection *connection)
+    : xcon(connection)
+    , applyTime(0)
+{
+}
+
+// connected outputs side by side at their preferred mode,
+// internal monitor first and primary
+DisplayLayout LayoutEngine::autoLayout()
+{
+    DisplayLayout result;
+    if (!xcon->isValid() || xcon->randrEventBase()<0) { return result; }
+    Display *dpy = xcon->display();
+    XRoundTrip trip(xcon);
+
+    XRRScreenResources *sr = XRRGetScreenResourcesCurrent(dpy, xcon->rootWindow());
+    if (sr == NULL) { return result; }
+    QStringList order;
+    for (int i=0;i<sr->noutput;++i) {
+        XRROutputInfo *info = XRRGetOutputInfo(dpy, sr, sr->outputs[i]);
+        if (info == NULL) { continue; }
+        LayoutOutput output;
+        output.name = QString::fromLocal8Bit(info->name, info->nameLen);
+        const XRRModeInfo *mode = info->nmode>0?findMode(sr, info->modes[0]):NULL;
+        if (info->connection == RR_Connected && mode) {
+            output.enabled = true;
+            output.size = QSize(mode->width, mode->height);
+            output.refresh = modeRefresh(mode);
+            if (Topology::isInternal(output.name)) { order.prepend(output.name); }
+            else { order.append(output.name); }
+        }
+        result.outputs[output.name] = output;
+        XRRFreeOutputInfo(info);
+    }
+    XRRFreeScreenResources(sr);
+
+    int x = 0;
+    for (int i=0;i<order.size();++i) {
+        LayoutOutput &output = result.outputs[order.at(i)];
+        output.pos = QPoint(x, 0);
+        output.primary = i == 0;
+        x += output.size.width();
+    }
+    return result;
+}
+
+// layout as configured in the X server
+DisplayLayout LayoutEngine::currentLayout()
+{
+    DisplayLayout result;
+    if (!xcon->isValid() || xcon->randrEventBase()<0) { return result; }
+    Display *dpy = xcon->display();
+    XRoundTrip trip(xcon);
+
+    XRRScreenResources *sr = XRRGetScreenResourcesCurrent(dpy, xcon->rootWindow());
+    if (sr == NULL) { return result; }
+    RROutput primary = XRRGetOutputPrimary(dpy, xcon->rootWindow());
+    for (int i=0;i<sr->noutput;++i) {
+        XRROutputInfo *info = XRRGetOutputInfo(dpy, sr, sr->outputs[i]);
+        if (info == NULL) { continue; }
+        LayoutOutput output;
+        output.name = QString::fromLocal8Bit(info->name, info->nameLen);
+        output.primary = sr->outputs[i] == primary;
+        if (info->crtc) {
+            XRRCrtcInfo *crtc = XRRGetCrtcInfo(dpy, sr, info->crtc);
+            const XRRModeInfo *mode = crtc?findMode(sr, crtc->mode):NULL;
+            if (crtc && mode) {
+                output.enabled = true;
+                output.size = QSize(mode->width, mode->height);
+                output.refresh = modeRefresh(mode);
+                output.pos = QPoint(crtc->x, crtc->y);
+                output.rotation = crtc->rotation;
+            }
+            if (crtc) { XRRFreeCrtcInfo(crtc); }
+        }
+        result.outputs[output.name] = output;
+        XRRFreeOutputInfo(info);
+    }
+    XRRFreeScreenResources(sr);
+    return result;
+}
+
+bool LayoutEngine::apply(const DisplayLayout &layout)
+{
+    if (!xcon->isValid() || xcon->randrEventBase()<0 || layout.isEmpty()) { return false; }
+    Display *dpy = xcon->display();
+    Window root = xcon->rootWindow();
+    QElapsedTimer timer;
+    timer.start();
+
+    // errors from earlier requests are not ours
+    XSync(dpy, False);
+    applyFailed = false;
+    XErrorHandler oldHandler = XSetErrorHandler(handleApplyError);
+    XGrabServer(dpy);
+
+    XRRScreenResources *sr = XRRGetScreenResourcesCurrent(dpy, root);
+    if (sr == NULL) {
+        XUngrabServer(dpy);
+        XSync(dpy, False);
+        XSetErrorHandler(oldHandler);
+        return false;
+    }
+
+    // resolve outputs to crtc and mode
+    QList<CrtcPlan> plans;
+    QHash<RRCrtc, int> used;
+    RROutput primary = None;
+    for (int i=0;i<sr->noutput;++i) {
+        XRROutputInfo *info = XRRGetOutputInfo(dpy, sr, sr->outputs[i]);
+        if (info == NULL) { continue; }
+        QString name = QString::fromLocal8Bit(info->name, info->nameLen);
+        CrtcPlan plan;
+        plan.output = sr->outputs[i];
+        plan.crtc = None;
+        plan.mode = None;
+        plan.x = 0;
+        plan.y = 0;
+        plan.rotation = RR_Rotate_0;
+        plan.info = info;
+        if (layout.outputs.contains(name) && layout.outputs[name].enabled) {
+            const LayoutOutput &target = layout.outputs[name];
+            plan.mode = resolveMode(sr, info, target.size, target.refresh);
+            plan.x = target.pos.x();
+            plan.y = target.pos.y();
+            plan.rotation = target.rotation;
+            if (plan.mode != None && target.primary) { primary = plan.output; }
+            if (plan.mode != None && info->crtc && !used.contains(info->crtc)) {
+                plan.crtc = info->crtc;
+                used.insert(plan.crtc, plans.size());
+            }
+        }
+        plans.append(plan);
+    }
+
+    // outputs without a crtc get a free one
+    for (int i=0;i<plans.size();++i) {
+        CrtcPlan &plan = plans[i];
+        if (plan.mode == None || plan.crtc != None) { continue; }
+        for (int j=0;j<plan.info->ncrtc;++j) {
+            if (used.contains(plan.info->crtcs[j])) { continue; }
+            plan.crtc = plan.info->crtcs[j];
+            used.insert(plan.crtc, i);
+            break;
+        }
+        if (plan.crtc == None) { plan.mode = None; }
+    }
+
+    QSize size = layout.screenSize();
+    int minWidth, minHeight, maxWidth, maxHeight;
+    if (XRRGetScreenSizeRange(dpy, root, &minWidth, &minHeight, &maxWidth, &maxHeight)) {
+        size = size.expandedTo(QSize(minWidth, minHeight)).boundedTo(QSize(maxWidth, maxHeight));
+    }
+
+    // disable crtcs that go away, change or don't fit the new screen,
+    // unchanged crtcs are left alone to avoid flicker
+    int screen = DefaultScreen(dpy);
+    int oldWidth = DisplayWidth(dpy, screen);
+    int oldHeight = DisplayHeight(dpy, screen);
+    int oldMmWidth = DisplayWidthMM(dpy, screen);
+    int oldMmHeight = DisplayHeightMM(dpy, screen);
+    QList<CrtcSaved> saved;
+    QHash<RRCrtc, bool> unchanged;
+    bool ok = true;
+    for (int i=0;i<sr->ncrtc;++i) {
+        RRCrtc id = sr->crtcs[i];
+        XRRCrtcInfo *crtc = XRRGetCrtcInfo(dpy, sr, id);
+        if (crtc == NULL) { continue; }
+        if (crtc->mode != None) {
+            CrtcSaved old;
+            old.crtc = id;
+            old.mode = crtc->mode;
+            old.x = crtc->x;
+            old.y = crtc->y;
+            old.rotation = crtc->rotation;
+            for (int j=0;j<crtc->noutput;++j) { old.outputs << crtc->outputs[j]; }
+            saved << old;
+
+            bool keep = false;
+            if (used.contains(id)) {
+                const CrtcPlan &plan = plans.at(used.value(id));
+                keep = plan.mode == crtc->mode && plan.x == crtc->x && plan.y == crtc->y &&
+                       plan.rotation == crtc->rotation && crtc->noutput == 1 && crtc->outputs[0] == plan.output &&
+                       crtc->x+(int)crtc->width <= size.width() && crtc->y+(int)crtc->height <= size.height();
+            }
+            if (keep) { unchanged.insert(id, true); }
+            else if (XRRSetCrtcConfig(dpy, sr, id, CurrentTime, 0, 0, None, RR_Rotate_0, NULL, 0) != RRSetConfigSuccess) { ok = false; }
+        }
+        XRRFreeCrtcInfo(crtc);
+    }
+
+    // no status, errors come through the handler
+    if (ok) {
+        int mmWidth = oldWidth>0?size.width()*oldMmWidth/oldWidth:0;
+        int mmHeight = oldHeight>0?size.height()*oldMmHeight/oldHeight:0;
+        XRRSetScreenSize(dpy, root, size.width(), size.height(), mmWidth, mmHeight);
+        XSync(dpy, False);
+        ok = !applyFailed;
+    }
+
+    for (int i=0;i<plans.size();++i) {
+        CrtcPlan &plan = plans[i];
+        if (ok && plan.mode != None && !unchanged.contains(plan.crtc) &&
+            XRRSetCrtcConfig(dpy, sr, plan.crtc, CurrentTime, plan.x, plan.y, plan.mode, plan.rotation, &plan.output, 1) != RRSetConfigSuccess) {
+            ok = false;
+        }
+        XRRFreeOutputInfo(plan.info);
+    }
+    if (ok && primary != None) { XRRSetOutputPrimary(dpy, root, primary); }
+    XSync(dpy, False);
+    if (applyFailed) { ok = false; }
+    if (!ok) {
+        qWarning() << "display layout failed, restoring the previous one";
+        restoreCrtcs(dpy, root, sr, saved, oldWidth, oldHeight, oldMmWidth, oldMmHeight);
+    }
+
+    XRRFreeScreenResources(sr);
+    XUngrabServer(dpy);
+    XSync(dpy, False);
+    XSetErrorHandler(oldHandler);
+
+    applyTime = timer.nsecsElapsed()/1000;
+    qDebug() << "applied display layout in" << applyTime << "usec" << (ok?"":"(rolled back)");
+    return ok;
+}
+
+// duration of the last apply in usec
+qint64 LayoutEngine::lastApplyTime()
+{
+    return applyTime;
+}
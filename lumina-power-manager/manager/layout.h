@@ -0,0 +1,70 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <QString>
+#include <QSize>
+#include <QPoint>
+#include <QMap>
+
+#include "xconnection.h"
+
+// target state for one output, refresh is in mHz (0 is any)
+struct LayoutOutput
+{
+    QString name;
+    bool enabled;
+    QSize size;
+    int refresh;
+    QPoint pos;
+    int rotation;
+    bool primary;
+
+    LayoutOutput()
+        : enabled(false)
+        , refresh(0)
+        , rotation(1)
+        , primary(false)
+    {
+    }
+    bool operator==(const LayoutOutput &other) const
+    {
+        return name == other.name && enabled == other.enabled && size == other.size &&
+               refresh == other.refresh && pos == other.pos && rotation == other.rotation &&
+               primary == other.primary;
+    }
+};
+
+class DisplayLayout
+{
+public:
+    QMap<QString, LayoutOutput> outputs;
+    bool isEmpty() const;
+    QSize screenSize() const;
+};
+
+// applies a display layout in process, all crtc changes are
+// done in one batch inside a server grab.
+class LayoutEngine
+{
+public:
+    explicit LayoutEngine(XConnection *connection);
+    DisplayLayout autoLayout();
+    DisplayLayout currentLayout();
+    bool apply(const DisplayLayout &layout);
+    qint64 lastApplyTime();
+
+private:
+    XConnection *xcon;
+    qint64 applyTime;
+};
+
+#endif // LAYOUT_H
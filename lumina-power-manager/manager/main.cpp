@@ -7,6 +7,22 @@
 
 #include "systray.h"
 #include <QApplication>
+#include <QSocketNotifier>
+#include "tracering.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static int signalFd[2];
+
+// only async-signal-safe calls here, the event loop does the rest
+static void handleSignal(int)
+{
+    char a = 1;
+    ssize_t ret = ::write(signalFd[0], &a, sizeof(a));
+    Q_UNUSED(ret)
+}
 
 int main(int argc, char *argv[])
 {
@@ -16,6 +32,23 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName("freedesktop");
     QCoreApplication::setOrganizationDomain("org");
 
+    // SIGUSR1 dumps the trace ring to the runtime dir
+    TraceRing::setName("lumina-power-manager");
+    TraceRing::installSignalHandler(SIGUSR1);
+
+    // quit the event loop on SIGTERM/SIGINT so everything is torn down
+    QSocketNotifier *signalNotifier = NULL;
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalFd) == 0) {
+        signalNotifier = new QSocketNotifier(signalFd[1], QSocketNotifier::Read, &a);
+        QObject::connect(signalNotifier, SIGNAL(activated(int)), &a, SLOT(quit()));
+        struct sigaction action;
+        action.sa_handler = handleSignal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGTERM, &action, 0);
+        sigaction(SIGINT, &action, 0);
+    }
+
     SysTray tray(a.parent());
     return a.exec();
 }
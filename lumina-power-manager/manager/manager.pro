@@ -11,15 +11,16 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = lumina-power-manager
 TEMPLATE = app
 
-SOURCES += main.cpp systray.cpp hotplug.cpp
-HEADERS += systray.h hotplug.h
+SOURCES += main.cpp systray.cpp powerdaemon.cpp xconnection.cpp topology.cpp hotplug.cpp layout.cpp profilestore.cpp batteryhistory.cpp kernellog.cpp policy.cpp latencytrace.cpp idletimer.cpp idlescheduler.cpp dpms.cpp backlight.cpp powersupply.cpp iconcache.cpp configwatcher.cpp powerservice.cpp powermetrics.cpp powerbackend.cpp inhibitregistry.cpp inhibitservice.cpp
+HEADERS += systray.h powerdaemon.h xconnection.h topology.h hotplug.h layout.h profilestore.h batteryhistory.h kernellog.h policy.h latencytrace.h idletimer.h idlescheduler.h dpms.h backlight.h powersupply.h iconcache.h configwatcher.h powerservice.h powermetrics.h powerbackend.h inhibitregistry.h inhibitservice.h
 RESOURCES += ../lumina-power-manager.qrc
 LIBS += -L../lib -lPower
 INCLUDEPATH += ..  ../lib
 
 CONFIG += link_pkgconfig
-PKGCONFIG += x11 xscrnsaver xrandr xinerama
+PKGCONFIG += x11 xext xscrnsaver xrandr
 
+include(../../lumina-trace/lumina-trace.pri)
 include(../../lumina-extra.pri)
 
 target.path = $${PREFIX}/bin
@@ -0,0 +1,117 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "policy.h"
+
+#include <cstring>
+#include <cmath>
+
+PowerPolicy::PowerPolicy()
+{
+    compile(PowerConfig());
+}
+
+PowerPolicy::PowerPolicy(const PowerConfig &config)
+{
+    compile(config);
+}
+
+// build the band and decision tables, only done when the settings change
+void PowerPolicy::compile(const PowerConfig &config)
+{
+    for (int i=0;i<=100;++i) {
+        Band result = bandCharged;
+        if (i<=config.criticalBattery) { result = bandCritical; }
+        else if (i<=config.lowBattery) { result = bandLow; }
+        else if (i<90) { result = bandGood; }
+        else if (i<99) { result = bandFull; }
+        bands[i] = result;
+    }
+
+    memset(table, actionNone, sizeof(table));
+    for (int ac=0;ac<2;++ac) {
+        for (int external=0;external<2;++external) {
+            for (int inhibited=0;inhibited<2;++inhibited) {
+                for (int band=0;band<bandCount;++band) {
+                    // lid ignores inhibitors, may be disabled with an external monitor
+                    bool lidDisabled = external && (ac?config.disableLidACExternalMonitor:config.disableLidBatteryExternalMonitor);
+                    if (!lidDisabled) {
+                        table[eventLidClosed][ac][external][inhibited][band] = lidToAction(ac?config.lidAC:config.lidBattery);
+                    }
+
+                    // wait for the inhibitor to go away
+                    int autoSleep = ac?config.autoSleepAC:config.autoSleepBattery;
+                    if (!inhibited && autoSleep>0) {
+                        table[eventIdle][ac][external][inhibited][band] = actionSuspend;
+                    }
+
+                    if (ac) { continue; }
+                    if (band<=bandLow) { table[eventBatteryLow][ac][external][inhibited][band] = actionNotifyLow; }
+                    if (band == bandCritical) {
+                        table[eventBatteryCritical][ac][external][inhibited][band] = criticalToAction(config.criticalAction);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// band for a battery percent, fractions round up
+PowerPolicy::Band PowerPolicy::band(double percent) const
+{
+    int index = (int)ceil(percent);
+    if (index<0) { index = 0; }
+    if (index>100) { index = 100; }
+    return (Band)bands[index];
+}
+
+PowerPolicy::Action PowerPolicy::decide(Event event, bool ac, bool external, bool inhibited, Band band) const
+{
+    if (event<0 || event>=eventCount || band<0 || band>=bandCount) { return actionNone; }
+    return (Action)table[event][ac?1:0][external?1:0][inhibited?1:0][band];
+}
+
+PowerPolicy::Action PowerPolicy::decide(Event event, bool ac, bool external, bool inhibited, double percent) const
+{
+    return decide(event, ac, external, inhibited, band(percent));
+}
+
+const char *PowerPolicy::actionName(Action action)
+{
+    switch(action) {
+    case actionLock: return "lock";
+    case actionSuspend: return "suspend";
+    case actionHibernate: return "hibernate";
+    case actionShutdown: return "shutdown";
+    case actionNotifyLow: return "notify-low";
+    default: ;
+    }
+    return "none";
+}
+
+PowerPolicy::Action PowerPolicy::lidToAction(int action)
+{
+    switch(action) {
+    case lidLock: return actionLock;
+    case lidSleep: return actionSuspend;
+    case lidHibernate: return actionHibernate;
+    default: ;
+    }
+    return actionNone;
+}
+
+PowerPolicy::Action PowerPolicy::criticalToAction(int action)
+{
+    switch(action) {
+    case criticalHibernate: return actionHibernate;
+    case criticalShutdown: return actionShutdown;
+    default: ;
+    }
+    return actionNone;
+}
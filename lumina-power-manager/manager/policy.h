@@ -0,0 +1,63 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "common.h"
+
+// power policy compiled from the settings into a decision table,
+// indexed by (event, ac, external monitor, inhibited, battery band).
+// a decision is one lookup, no X or D-Bus needed.
+class PowerPolicy
+{
+public:
+    enum Event
+    {
+        eventLidClosed,
+        eventIdle,
+        eventBatteryLow,
+        eventBatteryCritical,
+        eventCount
+    };
+    enum Action
+    {
+        actionNone,
+        actionLock,
+        actionSuspend,
+        actionHibernate,
+        actionShutdown,
+        actionNotifyLow
+    };
+    enum Band
+    {
+        bandCritical,
+        bandLow,
+        bandGood,
+        bandFull,
+        bandCharged,
+        bandCount
+    };
+
+    PowerPolicy();
+    explicit PowerPolicy(const PowerConfig &config);
+    void compile(const PowerConfig &config);
+    Band band(double percent) const;
+    Action decide(Event event, bool ac, bool external, bool inhibited, Band band) const;
+    Action decide(Event event, bool ac, bool external, bool inhibited, double percent) const;
+    static const char *actionName(Action action);
+
+private:
+    quint8 bands[101];
+    quint8 table[eventCount][2][2][2][bandCount];
+    static Action lidToAction(int action);
+    static Action criticalToAction(int action);
+};
+
+#endif // POLICY_H
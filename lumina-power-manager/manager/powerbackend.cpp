@@ -0,0 +1,75 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "powerbackend.h"
+#include "power.h"
+#include "common.h"
+
+#include <QDateTime>
+#include <QDBusConnection>
+#include <QDBusMessage>
+
+PowerBackend::PowerBackend(QObject *parent) :
+    QObject(parent)
+{
+}
+
+qint64 PowerBackend::now()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+UPowerBackend::UPowerBackend(QObject *parent) :
+    PowerBackend(parent)
+  , man(0)
+{
+    man = new Power(this);
+    connect(man, SIGNAL(updatedDevices()), this, SIGNAL(updatedDevices()));
+    connect(man, SIGNAL(closedLid()), this, SIGNAL(closedLid()));
+    connect(man, SIGNAL(openedLid()), this, SIGNAL(openedLid()));
+    connect(man, SIGNAL(switchedToBattery()), this, SIGNAL(switchedToBattery()));
+    connect(man, SIGNAL(switchedToAC()), this, SIGNAL(switchedToAC()));
+}
+
+bool UPowerBackend::onBattery()
+{
+    return man->onBattery();
+}
+
+double UPowerBackend::batteryLeft()
+{
+    return man->batteryLeft();
+}
+
+// Power does not report failures
+bool UPowerBackend::lockScreen()
+{
+    man->lockScreen();
+    return true;
+}
+
+bool UPowerBackend::suspend()
+{
+    man->suspend();
+    return true;
+}
+
+bool UPowerBackend::hibernate()
+{
+    man->hibernate();
+    return true;
+}
+
+// logind PowerOff, not interactive (no polkit prompt at critical battery)
+bool UPowerBackend::shutdown()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(LOGIND_SERVICE, LOGIND_PATH, LOGIND_MANAGER, "PowerOff");
+    message << false;
+    return QDBusConnection::systemBus().send(message);
+}
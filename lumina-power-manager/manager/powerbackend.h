@@ -0,0 +1,61 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef POWERBACKEND_H
+#define POWERBACKEND_H
+
+#include <QObject>
+
+class Power;
+
+// battery, lid and session actions as the daemon sees them.
+// UPowerBackend is the session, tests drive the daemon with their own.
+class PowerBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PowerBackend(QObject *parent = NULL);
+    virtual bool onBattery() = 0;
+    virtual double batteryLeft() = 0;
+    // false if the request could not be sent
+    virtual bool lockScreen() = 0;
+    virtual bool suspend() = 0;
+    virtual bool hibernate() = 0;
+    virtual bool shutdown() = 0;
+    // msec since epoch, for battery history
+    virtual qint64 now();
+
+signals:
+    void updatedDevices();
+    void closedLid();
+    void openedLid();
+    void switchedToBattery();
+    void switchedToAC();
+};
+
+// UPower/logind through lib Power, shutdown through logind
+class UPowerBackend : public PowerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit UPowerBackend(QObject *parent = NULL);
+    bool onBattery();
+    double batteryLeft();
+    bool lockScreen();
+    bool suspend();
+    bool hibernate();
+    bool shutdown();
+
+private:
+    Power *man;
+};
+
+#endif // POWERBACKEND_H
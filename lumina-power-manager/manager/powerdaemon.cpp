@@ -0,0 +1,740 @@
+/*
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+*/
+
+#include "powerdaemon.h"
+#include "tracering.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+
+PowerDaemon::PowerDaemon(QObject *parent, PowerBackend *backend, const PowerConfig *settings)
+    : QObject(parent)
+    , man(0)
+    , pm(0)
+    , ss(0)
+    , inhibitors(0)
+    , service(0)
+    , xcon(0)
+    , ht(0)
+    , layout(0)
+    , profiles(0)
+    , history(0)
+    , wasLowBattery(false)
+    , wasCritical(false)
+    , hasService(false)
+    , hasState(false)
+    , idle(0)
+    , scheduler(0)
+    , dpms(0)
+    , backlight(0)
+    , dimmedFrom(-1)
+    , blockedStages(0)
+    , supply(0)
+    , supplyOnBattery(false)
+    , watcher(0)
+    , lidAction(PowerPolicy::actionNone)
+    , checkPending(false)
+    , metrics(0)
+    , session(backend == NULL)
+{
+    startup.start();
+    metrics = new PowerMetrics(this);
+    metrics->setLidTrace(&lidTrace);
+
+    // settings first, everything below depends on them
+    if (session) {
+        watcher = new ConfigWatcher(PowerConfig::fileName(), this);
+        connect(watcher, SIGNAL(changed()), this, SLOT(loadSettings()));
+        config = PowerConfig::load();
+    } else if (settings) { config = *settings; }
+    policy.compile(config);
+
+    // inhibitors from both services, dropped when the client goes away
+    inhibitors = new InhibitRegistry(this);
+    inhibitors->setTimeout((qint64)config.inhibitTimeout*60000);
+    connect(inhibitors, SIGNAL(hasInhibitChanged(bool)), this, SLOT(handleHasInhibitChanged(bool)));
+    connect(inhibitors, SIGNAL(changed(int,bool)), this, SLOT(handleInhibitChanged(int,bool)));
+
+    // setup org.freedesktop.PowerManagement
+    pm = new PowerManagementService(inhibitors, this);
+    connect(pm, SIGNAL(update()), this, SLOT(loadSettings()));
+
+    // setup org.freedesktop.ScreenSaver
+    ss = new ScreenSaverService(inhibitors, this);
+    connect(ss, SIGNAL(userActivity()), this, SLOT(resetTimer()));
+
+    // setup battery history
+    history = new BatteryHistory(BatteryHistory::fileName());
+    if (session) {
+        QDBusConnection::systemBus().connect(LOGIND_SERVICE, LOGIND_PATH, LOGIND_MANAGER, "PrepareForSleep",
+                                             this, SLOT(handlePrepareForSleep(bool)));
+    }
+
+    // setup org.lumina.PowerManager and register, clients can connect from here
+    service = new PowerService(this);
+    service->setHistory(history);
+    service->setLidTrace(&lidTrace);
+    service->setInhibitRegistry(inhibitors);
+    connect(service, SIGNAL(settingsChanged(QVariantMap)), this, SLOT(applySettings(QVariantMap)));
+    if (session) { registerService(); }
+
+    // setup manager
+    man = backend?backend:new UPowerBackend(this);
+    connect(man, SIGNAL(updatedDevices()), this, SLOT(requestCheck()));
+    connect(man, SIGNAL(closedLid()), this, SLOT(handleClosedLid()));
+    connect(man, SIGNAL(openedLid()), this, SLOT(handleOpenedLid()));
+    connect(man, SIGNAL(switchedToBattery()), this, SLOT(handleOnBattery()));
+    connect(man, SIGNAL(switchedToAC()), this, SLOT(handleOnAC()));
+    setPowerBackend();
+    updateLidAction();
+
+    // first battery state as soon as the event loop runs,
+    // X setup waits until it is published
+    requestCheck();
+}
+
+// X connection, monitor hotplug, idle stages and backlight,
+// none of them are needed for the first battery state
+void PowerDaemon::startDeferred()
+{
+    if (xcon) { return; }
+
+    // setup shared X connection
+    xcon = new XConnection(this);
+    metrics->setConnection(xcon);
+
+    // setup monitor hotplug watcher
+    ht = new HotPlug(xcon, this);
+    connectDisplays(ht);
+    ht->requestScan();
+    layout = new LayoutEngine(xcon);
+    profiles = new ProfileStore(ProfileStore::fileName());
+    connect(ht, SIGNAL(layoutChanged()), this, SLOT(handleLayoutChanged()));
+
+    // setup idle timer
+    idle = new IdleTimer(xcon, this);
+    scheduler = new IdleScheduler(idle, this);
+    connectIdle(scheduler);
+    dpms = new Dpms(xcon);
+    backlight = new Backlight(xcon, config.backlightRoot, this);
+    setIdleTimeout();
+
+    markStartup("deferred");
+}
+
+// msec from construction to a startup milestone, logged and kept for Startup()
+void PowerDaemon::markStartup(const QString &point)
+{
+    qint64 msec = startup.elapsed();
+    service->setStartupTime(point, msec);
+    static const char *points[] = { "service", "first_state", "deferred", NULL };
+    int id = 0;
+    while (points[id] && point != points[id]) { id++; }
+    TraceRing::record(tracePowerStartup, id, (qint32)msec);
+    qDebug() << "startup:" << point << "in" << msec << "ms";
+}
+
+PowerDaemon::~PowerDaemon()
+{
+    // X consumers must go before the shared connection
+    delete ht;
+    delete layout;
+    delete profiles;
+    delete history;
+    delete scheduler;
+    delete idle;
+    delete dpms;
+    delete backlight;
+}
+
+// sleep inhibitors block auto sleep, screensaver inhibitors block
+// dim, screen off and lock. counter lookup
+bool PowerDaemon::hasInhibit(InhibitRegistry::Kind kind)
+{
+    return inhibitors->hasInhibit(kind);
+}
+
+static qint64 roundMinutes(qint64 seconds)
+{
+    if (seconds<=0) { return seconds; }
+    return (seconds/60)*60;
+}
+
+// current battery state as published to tray clients
+QVariantMap PowerDaemon::state()
+{
+    QVariantMap result;
+    double left = batteryLevel();
+    result["percent"] = left;
+    result["on_battery"] = onBattery();
+    result["band"] = (int)policy.band(left);
+    // whole minutes, what the tray shows, so a new estimate alone is no change
+    result["time_to_empty"] = roundMinutes(history->timeToEmpty());
+    result["time_to_full"] = roundMinutes(history->timeToFull());
+    if (supply) {
+        const PowerSnapshot &snapshot = supply->snapshot();
+        QVariantList batteries;
+        for (int i=0;i<snapshot.batteries.size();++i) { batteries << snapshot.batteries.at(i).toMap(); }
+        result["batteries"] = batteries;
+        result["rate"] = snapshot.rate;
+    }
+    result["inhibit_sleep"] = hasInhibit(InhibitRegistry::kindSleep);
+    result["inhibit_screensaver"] = hasInhibit(InhibitRegistry::kindScreenSaver);
+    return result;
+}
+
+// counters for in process clients (the tray)
+PowerMetrics *PowerDaemon::powerMetrics()
+{
+    return metrics;
+}
+
+InhibitRegistry *PowerDaemon::inhibitRegistry()
+{
+    return inhibitors;
+}
+
+// NULL until startDeferred
+HotPlug *PowerDaemon::hotPlug()
+{
+    return ht;
+}
+
+// monitor changes, from HotPlug or a fake topology in tests
+void PowerDaemon::connectDisplays(QObject *source)
+{
+    qRegisterMetaType<QMap<QString,bool> >("QMap<QString,bool>");
+    connect(source, SIGNAL(changed(QMap<QString,bool>,int)), this, SLOT(handleDisplays(QMap<QString,bool>,int)));
+    connect(source, SIGNAL(found(QMap<QString,bool>)), this, SLOT(handleFoundDisplays(QMap<QString,bool>)));
+}
+
+// idle stages, from IdleScheduler or a fake in tests
+void PowerDaemon::connectIdle(QObject *source)
+{
+    connect(source, SIGNAL(stageReached(int)), this, SLOT(handleIdleStage(int)));
+    connect(source, SIGNAL(resumed(int)), this, SLOT(handleIdleResumed(int)));
+}
+
+// another instance (daemon or tray) already owns the session service
+bool PowerDaemon::isRunning()
+{
+    if (!QDBusConnection::sessionBus().isConnected()) { return false; }
+    return QDBusConnection::sessionBus().interface()->isServiceRegistered(LPM_SERVICE);
+}
+
+// power source from the sysfs snapshot if enabled, else UPower
+bool PowerDaemon::onBattery()
+{
+    if (supply) { return supply->snapshot().onBattery; }
+    return man->onBattery();
+}
+
+double PowerDaemon::batteryLevel()
+{
+    if (supply) { return supply->snapshot().percent; }
+    return man->batteryLeft();
+}
+
+// start or stop the sysfs backend
+void PowerDaemon::setPowerBackend()
+{
+    if (config.sysfsBackend && !supply) {
+        supply = new PowerSupply(config.powerSupplyRoot, this);
+        if (!supply->isValid()) {
+            qWarning() << "no power supplies in" << config.powerSupplyRoot << "using UPower";
+            delete supply;
+            supply = NULL;
+            service->setPowerSupply(supply);
+            return;
+        }
+        supplyOnBattery = supply->snapshot().onBattery;
+        connect(supply, SIGNAL(changed()), this, SLOT(handleSupplyChanged()));
+    } else if (!config.sysfsBackend && supply) {
+        delete supply;
+        supply = NULL;
+    }
+    service->setPowerSupply(supply);
+}
+
+// sysfs has no switch signals, compare with the last snapshot
+void PowerDaemon::handleSupplyChanged()
+{
+    bool battery = supply->snapshot().onBattery;
+    if (battery != supplyOnBattery) {
+        supplyOnBattery = battery;
+        if (battery) { handleOnBattery(); }
+        else { handleOnAC(); }
+    }
+    requestCheck();
+}
+
+// device updates come in bursts (AC plug, multiple batteries),
+// all updates from one event loop turn are merged into one check
+void PowerDaemon::requestCheck()
+{
+    if (sender() && sender() == man) { metrics->add(PowerMetrics::counterWakeupUPower); }
+    else if (sender() && sender() == supply) { metrics->add(PowerMetrics::counterWakeupSysfs); }
+    metrics->add(PowerMetrics::counterStateUpdates);
+    if (checkPending) {
+        metrics->add(PowerMetrics::counterStateMerged);
+        return;
+    }
+    checkPending = true;
+    QTimer::singleShot(0, this, SLOT(checkDevices()));
+}
+
+void PowerDaemon::checkDevices()
+{
+    checkPending = false;
+    QElapsedTimer timer;
+    timer.start();
+
+    // one read per update, sysfs snapshot or UPower
+    bool battery = onBattery();
+    double batteryLeft = batteryLevel();
+    history->addSample(batteryLeft, !battery, man->now());
+
+    PowerPolicy::Band band = policy.band(batteryLeft);
+    checkLowBattery(band);
+    publish();
+    if (!hasState) {
+        hasState = true;
+        markStartup("first_state");
+        if (session) { QTimer::singleShot(0, this, SLOT(startDeferred())); }
+    }
+
+    // critical battery? predicted to run out counts as critical
+    if (config.criticalPredict && history->isCritical()) { band = PowerPolicy::bandCritical; }
+    if (!wasCritical && decide(PowerPolicy::eventBatteryCritical, band) != PowerPolicy::actionNone) { handleCritical(); }
+
+    // Register service if not already registered
+    if (session && !hasService) { registerService(); }
+    metrics->addSample(PowerMetrics::histogramCheck, timer.nsecsElapsed()/1000);
+}
+
+// send the current state to local and D-Bus clients
+// only changed states are sent
+void PowerDaemon::publish()
+{
+    QVariantMap current = state();
+    if (!service->setState(current)) {
+        metrics->add(PowerMetrics::counterStateUnchanged);
+        return;
+    }
+    emit stateChanged(current);
+    TraceRing::record(tracePowerState, qRound(current.value("percent").toDouble()*10),
+                      current.value("band").toInt(), current.value("on_battery").toBool());
+    qDebug() << "device updates" << metrics->value(PowerMetrics::counterStateUpdates)
+             << "merged" << metrics->value(PowerMetrics::counterStateMerged)
+             << "unchanged" << metrics->value(PowerMetrics::counterStateUnchanged);
+}
+
+void PowerDaemon::sendNotify(const QString &title, const QString &message)
+{
+    service->notify(title, message);
+    emit notify(title, message);
+}
+
+// notify once when the battery gets low
+void PowerDaemon::checkLowBattery(PowerPolicy::Band band)
+{
+    if (decide(PowerPolicy::eventBatteryLow, band) == PowerPolicy::actionNotifyLow) {
+        if (!wasLowBattery) { sendNotify(tr("Low Battery!"), tr("You battery is almost empty, please consider connecting your computer to a power supply.")); }
+        wasLowBattery = true;
+    } else { wasLowBattery = false; }
+}
+
+// what to do when user open/close lid
+void PowerDaemon::handleClosedLid()
+{
+    // the action is kept up to date, only dispatch here
+    lidTrace.begin();
+    PowerPolicy::Action action = lidAction;
+    lidTrace.mark(LatencyTrace::pointDecision);
+    TraceRing::record(tracePowerLidClosed, action);
+    metrics->add(PowerMetrics::counterLidClosed);
+    runAction(action);
+    if (action != PowerPolicy::actionSuspend && action != PowerPolicy::actionHibernate) { lidTrace.end(); }
+    qDebug() << "lid action" << PowerPolicy::actionName(action);
+}
+
+// precompute the lid action, called when power source, monitors or settings change
+void PowerDaemon::updateLidAction()
+{
+    lidAction = decide(PowerPolicy::eventLidClosed, PowerPolicy::bandGood);
+    qDebug() << "lid action ready" << PowerPolicy::actionName(lidAction) << monitors;
+}
+
+// do something when lid is opened
+void PowerDaemon::handleOpenedLid()
+{
+    TraceRing::record(tracePowerLidOpened);
+    metrics->add(PowerMetrics::counterLidOpened);
+    lidTrace.cancel();
+}
+
+// do something when switched to battery power
+void PowerDaemon::handleOnBattery()
+{
+    if (supply && sender() == man) { return; } // sysfs backend, see handleSupplyChanged
+    TraceRing::record(tracePowerSource, 1);
+    if (config.trayNotify) { sendNotify(tr("On Battery"), tr("Switched to battery power.")); }
+    setIdleTimeout();
+    setBrightness();
+    updateLidAction();
+}
+
+// do something when switched to ac power
+void PowerDaemon::handleOnAC()
+{
+    if (supply && sender() == man) { return; }
+    TraceRing::record(tracePowerSource, 0);
+    if (config.trayNotify) { sendNotify(tr("On AC"), tr("Switched to AC power.")); }
+    wasCritical = false;
+    setIdleTimeout();
+    setBrightness();
+    updateLidAction();
+}
+
+// load settings and apply changes
+void PowerDaemon::loadSettings()
+{
+    metrics->add(PowerMetrics::counterWakeupConfig);
+    applyConfig(PowerConfig::load());
+}
+
+// apply settings sent from the settings dialog. the dialog saved
+// them before the call, so the watcher skips reloading that write
+void PowerDaemon::applySettings(const QVariantMap &settings)
+{
+    if (watcher) { watcher->sync(); }
+    PowerConfig current = config;
+    QMapIterator<QString, QVariant> i(settings);
+    while (i.hasNext()) {
+        i.next();
+        current.setValue(i.key(), i.value());
+    }
+    applyConfig(current);
+}
+
+// only apply fields that changed
+void PowerDaemon::applyConfig(const PowerConfig &current)
+{
+    int changed = config.diff(current);
+    config = current;
+    TraceRing::record(tracePowerSettings, changed);
+    metrics->add(PowerMetrics::counterSettingsReloads);
+    qDebug() << "settings changed" << changed;
+    if (!changed) { return; }
+
+    if (changed & (configSysfsBackend|configPowerSupplyRoot)) {
+        if (supply) {
+            service->setPowerSupply(NULL);
+            delete supply;
+            supply = NULL;
+        }
+        setPowerBackend();
+    }
+    policy.compile(config);
+    updateLidAction();
+    if (changed & configInhibitTimeout) { inhibitors->setTimeout((qint64)config.inhibitTimeout*60000); }
+    if (changed & (configAutoSleepBattery|configAutoSleepAC|configScreenOffBattery|configScreenOffAC|
+                   configLockBattery|configLockAC|configDimBattery|configDimAC)) {
+        setIdleTimeout();
+    }
+    if ((changed & configBacklightRoot) && backlight) {
+        delete backlight;
+        backlight = new Backlight(xcon, config.backlightRoot, this);
+        dimmedFrom = -1;
+    }
+    if (changed & (configBrightnessBattery|configBrightnessAC|configBacklightRoot)) { setBrightness(); }
+}
+
+// register session service
+void PowerDaemon::registerService()
+{
+    if (hasService) { return; }
+    if (!QDBusConnection::sessionBus().isConnected()) {
+        qWarning("Cannot connect to D-Bus.");
+        return;
+    }
+    if (!QDBusConnection::sessionBus().registerService(LPM_SERVICE)) {
+        qWarning() << QDBusConnection::sessionBus().lastError().message();
+        return;
+    }
+    if (!QDBusConnection::sessionBus().objectRegisteredAt(LPM_PATH) &&
+        !QDBusConnection::sessionBus().registerObject(LPM_PATH, service, QDBusConnection::ExportAllSlots|QDBusConnection::ExportScriptableSignals)) {
+        qWarning() << QDBusConnection::sessionBus().lastError().message();
+        return;
+    }
+    if (!QDBusConnection::sessionBus().objectRegisteredAt(LPM_METRICS_PATH) &&
+        !QDBusConnection::sessionBus().registerObject(LPM_METRICS_PATH, metrics, QDBusConnection::ExportAllSlots)) {
+        qWarning() << QDBusConnection::sessionBus().lastError().message();
+    }
+    if (config.desktopPM) {
+    if (!QDBusConnection::sessionBus().registerService(PM_SERVICE)) {
+        qWarning() << QDBusConnection::sessionBus().lastError().message();
+        return;
+    }
+        if (!QDBusConnection::sessionBus().registerObject(PM_PATH, pm, QDBusConnection::ExportAllContents)) {
+        qWarning() << QDBusConnection::sessionBus().lastError().message();
+        return;
+    }
+        qDebug() << "Enabled org.freedesktop.PowerManagement";
+    }
+    if (config.desktopSS) {
+        if (!QDBusConnection::sessionBus().registerService(SS_SERVICE)) {
+            qWarning() << QDBusConnection::sessionBus().lastError().message();
+            return;
+        }
+        if (!QDBusConnection::sessionBus().registerObject(SS_PATH, ss, QDBusConnection::ExportAllContents)) {
+            qWarning() << QDBusConnection::sessionBus().lastError().message();
+            return;
+        }
+        qDebug() << "Enabled org.freedesktop.ScreenSaver";
+    }
+    hasService = true;
+    markStartup("service");
+}
+
+// dbus session inhibit status handler
+void PowerDaemon::handleHasInhibitChanged(bool has_inhibit)
+{
+    TraceRing::record(tracePowerInhibit, has_inhibit);
+    metrics->setInhibited(has_inhibit);
+    qDebug() << "HasInhibitChanged?" << has_inhibit;
+}
+
+// a kind was inhibited or released, the stages it blocked
+// run after a full timeout
+void PowerDaemon::handleInhibitChanged(int kind, bool inhibited)
+{
+    qDebug() << "inhibit changed" << InhibitRegistry::kindName(kind) << inhibited;
+    publish();
+    if (inhibited || !scheduler) { return; }
+    int stages = blockedStages & (kind == InhibitRegistry::kindSleep?(1<<IdleScheduler::stageSuspend):~(1<<IdleScheduler::stageSuspend));
+    if (!stages) { return; }
+    blockedStages &= ~stages;
+    scheduler->retry(stages);
+}
+
+// logind is about to sleep (true) or has resumed (false).
+// the kernel log is read from sleep on, it has the image write
+// time if we hibernated
+void PowerDaemon::handlePrepareForSleep(bool sleep)
+{
+    TraceRing::record(tracePowerSleep, sleep);
+    metrics->add(PowerMetrics::counterWakeupLogind);
+    metrics->add(sleep?PowerMetrics::counterSleepEntered:PowerMetrics::counterResumed);
+    if (sleep) {
+        kernelLog.mark();
+        history->sleepAction(man->now());
+        lidTrace.mark(LatencyTrace::pointSleep);
+    } else {
+        double written = -1;
+        QStringList lines = kernelLog.lines();
+        kernelLog.close();
+        for (int i=0;i<lines.size();++i) {
+            double seconds = KernelLog::imageWriteTime(lines.at(i));
+            if (seconds>=0) { written = seconds; }
+        }
+        wasCritical = false;
+        history->finishAction(man->now(), written);
+        lidTrace.mark(LatencyTrace::pointResume);
+        lidTrace.end();
+    }
+}
+
+// handle critical battery
+void PowerDaemon::handleCritical()
+{
+    PowerPolicy::Action action = decide(PowerPolicy::eventBatteryCritical, PowerPolicy::bandCritical);
+    TraceRing::record(tracePowerCritical, action, (qint32)history->timeToEmpty(), qRound(history->actionDuration()));
+    qDebug() << "critical battery level, action?" << PowerPolicy::actionName(action)
+             << "time left" << history->timeToEmpty() << "action takes" << history->actionDuration();
+    if (action == PowerPolicy::actionNone) { return; }
+    // once per discharge, whatever the action. only hibernate is
+    // timed (until resume), see BatteryHistory::finishAction
+    wasCritical = true;
+    bool timed = action == PowerPolicy::actionHibernate;
+    if (timed) { history->startAction(man->now()); }
+    if (!runAction(action) && timed) { history->cancelAction(); }
+}
+
+// policy decision for the current power state
+PowerPolicy::Action PowerDaemon::decide(PowerPolicy::Event event, PowerPolicy::Band band)
+{
+    return policy.decide(event, !onBattery(), externalMonitorIsConnected(), hasInhibit(InhibitRegistry::kindSleep), band);
+}
+
+// false if the request was not sent
+bool PowerDaemon::runAction(PowerPolicy::Action action)
+{
+    if (action != PowerPolicy::actionNone) { TraceRing::record(tracePowerAction, action); }
+    bool result = false;
+    switch(action) {
+    case PowerPolicy::actionLock:
+        metrics->add(PowerMetrics::counterLockRequests);
+        result = man->lockScreen();
+        lidTrace.mark(LatencyTrace::pointLock);
+        break;
+    case PowerPolicy::actionSuspend:
+        metrics->add(PowerMetrics::counterSuspendRequests);
+        result = man->suspend();
+        lidTrace.mark(LatencyTrace::pointSuspend);
+        break;
+    case PowerPolicy::actionHibernate:
+        metrics->add(PowerMetrics::counterHibernateRequests);
+        result = man->hibernate();
+        lidTrace.mark(LatencyTrace::pointSuspend);
+        break;
+    case PowerPolicy::actionShutdown:
+        metrics->add(PowerMetrics::counterShutdownRequests);
+        result = man->shutdown();
+        break;
+    default: ;
+    }
+    return result;
+}
+
+// user activity without input, idle stages start over
+void PowerDaemon::resetTimer()
+{
+    if (!scheduler) { return; }
+    scheduler->restart();
+}
+
+// set idle timeout for the current power source
+void PowerDaemon::setIdleTimeout()
+{
+    if (!scheduler) { return; }
+    bool battery = onBattery();
+    scheduler->setStage(IdleScheduler::stageDim, (qint64)(battery?config.dimBattery:config.dimAC)*1000);
+    scheduler->setStage(IdleScheduler::stageScreenOff, (qint64)(battery?config.screenOffBattery:config.screenOffAC)*1000);
+    scheduler->setStage(IdleScheduler::stageLock, (qint64)(battery?config.lockBattery:config.lockAC)*1000);
+    scheduler->setStage(IdleScheduler::stageSuspend, (qint64)(battery?config.autoSleepBattery:config.autoSleepAC)*60000);
+}
+
+// idle stage reached, auto sleep waits for sleep inhibitors,
+// the other stages for screensaver inhibitors
+void PowerDaemon::handleIdleStage(int stage)
+{
+    bool inhibited = hasInhibit(stage == IdleScheduler::stageSuspend?InhibitRegistry::kindSleep:InhibitRegistry::kindScreenSaver);
+    TraceRing::record(tracePowerIdleStage, stage, inhibited);
+    metrics->add(PowerMetrics::counterWakeupIdle);
+    if (inhibited) {
+        blockedStages |= 1<<stage;
+        return;
+    }
+    switch(stage) {
+    case IdleScheduler::stageDim:
+        if (!backlight) { break; }
+        dimmedFrom = backlight->brightness();
+        if (dimmedFrom>DIM_BRIGHTNESS) { backlight->fade(DIM_BRIGHTNESS, 1000); }
+        else { dimmedFrom = -1; }
+        break;
+    case IdleScheduler::stageScreenOff:
+        if (dpms) { dpms->screenOff(); }
+        break;
+    case IdleScheduler::stageLock:
+        man->lockScreen();
+        break;
+    case IdleScheduler::stageSuspend:
+        runAction(decide(PowerPolicy::eventIdle, PowerPolicy::bandGood));
+        break;
+    default: ;
+    }
+}
+
+// user is back
+void PowerDaemon::handleIdleResumed(int stages)
+{
+    TraceRing::record(tracePowerIdleResumed, stages);
+    blockedStages = 0;
+    metrics->add(PowerMetrics::counterWakeupIdle);
+    if ((stages & (1<<IdleScheduler::stageScreenOff)) && dpms) { dpms->screenOn(); }
+    if ((stages & (1<<IdleScheduler::stageDim)) && dimmedFrom>=0 && backlight) {
+        backlight->fade(dimmedFrom, 250);
+        dimmedFrom = -1;
+    }
+}
+
+// brightness level for the current power source
+void PowerDaemon::setBrightness()
+{
+    int level = onBattery()?config.brightnessBattery:config.brightnessAC;
+    if (level<=0 || !backlight) { return; }
+    dimmedFrom = -1;
+    backlight->fade(level, 500);
+}
+
+// apply the net display change from a settled hotplug burst
+void PowerDaemon::handleDisplays(QMap<QString,bool> displays, int events)
+{
+    metrics->add(PowerMetrics::counterHotplugEvents, events);
+    metrics->add(PowerMetrics::counterHotplugChanges);
+    qDebug() << "merged hotplug events" << events << displays;
+
+    QMapIterator<QString,bool> i(displays);
+    while (i.hasNext()) {
+        i.next();
+        monitors[i.key()] = i.value();
+    }
+    updateLidAction();
+    if (!layout) { return; } // no X (tests)
+
+    // known monitors get the layout the user saved, else auto layout.
+    // disconnected outputs are turned off, else we end up with a
+    // virtual screen with the apps from that screen
+    DisplayLayout target = profiles->restore(ht->topology());
+    bool restored = !target.isEmpty();
+    if (!restored) { target = layout->autoLayout(); }
+    bool applied = layout->apply(target);
+    if (!applied) { qWarning() << "failed to apply display layout"; }
+    else { ht->ignoreOwnLayout(); }
+    TraceRing::record(tracePowerHotplug, events, restored, applied, (qint32)layout->lastApplyTime());
+    metrics->addSample(PowerMetrics::histogramHotplugApply, layout->lastApplyTime());
+    qDebug() << "hotplug configured in" << ht->burstElapsed() << "ms, apply" << layout->lastApplyTime() << "usec" << (restored?"(profile)":"(auto)");
+}
+
+// monitors are the same but the layout was changed (by the user), remember it
+void PowerDaemon::handleLayoutChanged()
+{
+    profiles->store(ht->topology(), layout->currentLayout());
+}
+
+void PowerDaemon::handleFoundDisplays(QMap<QString, bool> displays)
+{
+    qDebug() << displays;
+    monitors = displays;
+    updateLidAction();
+}
+
+bool PowerDaemon::internalMonitorIsConnected()
+{
+    QMapIterator<QString, bool> i(monitors);
+    while (i.hasNext()) {
+        i.next();
+        if (Topology::isInternal(i.key())) {
+            qDebug() << "internal monitor connected?" << i.key() << i.value();
+            return i.value();
+        }
+    }
+    return false;
+}
+
+bool PowerDaemon::externalMonitorIsConnected()
+{
+    QMapIterator<QString, bool> i(monitors);
+    while (i.hasNext()) {
+        i.next();
+        if (!Topology::isInternal(i.key()) && !i.key().startsWith(VIRTUAL_MONITOR)) {
+            qDebug() << "external monitor connected?" << i.key() << i.value();
+            if (i.value()) { return true; }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,144 @@
+/*
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+*/
+
+#ifndef POWERDAEMON_H
+#define POWERDAEMON_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QSettings>
+#include <QMap>
+#include <QMapIterator>
+
+#include "common.h"
+#include "powerbackend.h"
+#include "inhibitregistry.h"
+#include "inhibitservice.h"
+
+#include "xconnection.h"
+#include "hotplug.h"
+#include "layout.h"
+#include "profilestore.h"
+#include "idletimer.h"
+#include "idlescheduler.h"
+#include "dpms.h"
+#include "backlight.h"
+#include "powersupply.h"
+#include "configwatcher.h"
+#include "powerservice.h"
+#include "powermetrics.h"
+#include "batteryhistory.h"
+#include "kernellog.h"
+#include "policy.h"
+#include "latencytrace.h"
+// fix X11 inc
+#undef CursorShape
+//#undef Bool
+#undef Status
+
+// policy, session services and X event handling without any widgets.
+// the tray (or any other client) follows stateChanged/notify, locally
+// or as StateChanged/Notify on org.lumina.PowerManager.
+class PowerDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    // with a backend the daemon runs on the given settings, without
+    // the settings file, D-Bus services or X (see tests/)
+    explicit PowerDaemon(QObject *parent = NULL, PowerBackend *backend = NULL, const PowerConfig *settings = NULL);
+    ~PowerDaemon();
+    QVariantMap state();
+    PowerMetrics *powerMetrics();
+    InhibitRegistry *inhibitRegistry();
+    HotPlug *hotPlug();
+    void connectDisplays(QObject *source);
+    void connectIdle(QObject *source);
+    static bool isRunning();
+
+signals:
+    void stateChanged(const QVariantMap &state);
+    void notify(const QString &title, const QString &message);
+
+private:
+    PowerBackend *man;
+    PowerManagementService *pm;
+    ScreenSaverService *ss;
+    InhibitRegistry *inhibitors;
+    PowerService *service;
+    XConnection *xcon;
+    HotPlug *ht;
+    LayoutEngine *layout;
+    ProfileStore *profiles;
+    BatteryHistory *history;
+    KernelLog kernelLog;
+    bool wasLowBattery;
+    bool wasCritical;
+    bool hasService;
+    bool hasState;
+    QElapsedTimer startup;
+    IdleTimer *idle;
+    IdleScheduler *scheduler;
+    Dpms *dpms;
+    Backlight *backlight;
+    int dimmedFrom;
+    int blockedStages;
+    PowerSupply *supply;
+    bool supplyOnBattery;
+    ConfigWatcher *watcher;
+    PowerConfig config;
+    PowerPolicy policy;
+    PowerPolicy::Action lidAction;
+    LatencyTrace lidTrace;
+    QMap<QString, bool> monitors;
+    bool checkPending;
+    PowerMetrics *metrics;
+    bool session;
+
+private slots:
+    bool hasInhibit(InhibitRegistry::Kind kind);
+    void startDeferred();
+    void markStartup(const QString &point);
+    void requestCheck();
+    void checkDevices();
+    bool onBattery();
+    double batteryLevel();
+    void setPowerBackend();
+    void handleSupplyChanged();
+    void publish();
+    void sendNotify(const QString &title, const QString &message);
+    void handleClosedLid();
+    void handleOpenedLid();
+    void updateLidAction();
+    void handleOnBattery();
+    void handleOnAC();
+    void loadSettings();
+    void applySettings(const QVariantMap &settings);
+    void applyConfig(const PowerConfig &current);
+    void registerService();
+    void handleHasInhibitChanged(bool has_inhibit);
+    void handleInhibitChanged(int kind, bool inhibited);
+    void handleCritical();
+    PowerPolicy::Action decide(PowerPolicy::Event event, PowerPolicy::Band band);
+    bool runAction(PowerPolicy::Action action);
+    void handlePrepareForSleep(bool sleep);
+    void checkLowBattery(PowerPolicy::Band band);
+    void resetTimer();
+    void setIdleTimeout();
+    void handleIdleStage(int stage);
+    void handleIdleResumed(int stages);
+    void setBrightness();
+    void handleDisplays(QMap<QString,bool> displays, int events);
+    void handleLayoutChanged();
+    void handleFoundDisplays(QMap<QString,bool> displays);
+    bool internalMonitorIsConnected();
+    bool externalMonitorIsConnected();
+};
+
+#endif // POWERDAEMON_H
@@ -0,0 +1,178 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "powermetrics.h"
+
+#define METRICS_PREFIX "lumina_power_"
+
+// histogram names and units, value * scale is seconds
+static const char *histogramNames[PowerMetrics::histogramCount] = {
+    "hotplug_apply",
+    "inhibit",
+    "check"
+};
+static const double histogramScales[PowerMetrics::histogramCount] = {
+    0.000001,
+    0.001,
+    0.000001
+};
+static const char *histogramUnits[PowerMetrics::histogramCount] = {
+    "_us",
+    "_ms",
+    "_us"
+};
+
+// cumulative buckets as prometheus wants them, bucket n ends at 2^(n+1)
+static void appendHistogram(QString *out, const QString &name, const QString &labels,
+                            const LatencyHistogram &histogram, double scale)
+{
+    QString prefix = labels.isEmpty()?QString():QString("%1,").arg(labels);
+    quint64 cumulative = 0;
+    for (int i=0;i<LATENCY_BUCKETS-1;++i) {
+        cumulative += histogram.buckets[i];
+        out->append(QString("%1_bucket{%2le=\"%3\"} %4\n").arg(name).arg(prefix)
+                    .arg((double)((qint64)1<<(i+1))*scale).arg(cumulative));
+    }
+    QString suffix = labels.isEmpty()?QString():QString("{%1}").arg(labels);
+    out->append(QString("%1_bucket{%2le=\"+Inf\"} %3\n").arg(name).arg(prefix).arg(histogram.count));
+    out->append(QString("%1_sum%2 %3\n").arg(name).arg(suffix).arg((double)histogram.sum*scale));
+    out->append(QString("%1_count%2 %3\n").arg(name).arg(suffix).arg(histogram.count));
+}
+
+PowerMetrics::PowerMetrics(QObject *parent) :
+    QObject(parent)
+  , isInhibited(false)
+  , xcon(NULL)
+  , lidTrace(NULL)
+{
+}
+
+void PowerMetrics::add(Counter counter, int value)
+{
+    if (counter<0 || counter>=counterCount) { return; }
+    counters[counter].fetchAndAddRelaxed(value);
+}
+
+int PowerMetrics::value(Counter counter)
+{
+    if (counter<0 || counter>=counterCount) { return 0; }
+    return counters[counter].fetchAndAddRelaxed(0);
+}
+
+void PowerMetrics::addSample(Histogram histogram, qint64 value)
+{
+    if (histogram<0 || histogram>=histogramCount) { return; }
+    histograms[histogram].add(value);
+}
+
+// count inhibitions and how long they last
+void PowerMetrics::setInhibited(bool inhibited)
+{
+    if (inhibited == isInhibited) { return; }
+    isInhibited = inhibited;
+    if (inhibited) {
+        add(counterInhibitions);
+        inhibitTimer.start();
+    } else { addSample(histogramInhibit, inhibitTimer.elapsed()); }
+}
+
+// NULL until the deferred X setup is done
+void PowerMetrics::setConnection(XConnection *connection)
+{
+    xcon = connection;
+}
+
+void PowerMetrics::setLidTrace(LatencyTrace *trace)
+{
+    lidTrace = trace;
+}
+
+const char *PowerMetrics::counterName(Counter counter)
+{
+    switch(counter) {
+    case counterSuspendRequests: return "suspend_requests";
+    case counterHibernateRequests: return "hibernate_requests";
+    case counterShutdownRequests: return "shutdown_requests";
+    case counterLockRequests: return "lock_requests";
+    case counterSleepEntered: return "sleep_entered";
+    case counterResumed: return "resumed";
+    case counterLidClosed: return "lid_closed";
+    case counterLidOpened: return "lid_opened";
+    case counterHotplugEvents: return "hotplug_events";
+    case counterHotplugChanges: return "hotplug_changes";
+    case counterIconRedraws: return "icon_redraws";
+    case counterSettingsReloads: return "settings_reloads";
+    case counterInhibitions: return "inhibitions";
+    case counterStateUpdates: return "state_updates";
+    case counterStateMerged: return "state_updates_merged";
+    case counterStateUnchanged: return "state_updates_unchanged";
+    case counterWakeupUPower: return "wakeups_upower";
+    case counterWakeupSysfs: return "wakeups_sysfs";
+    case counterWakeupIdle: return "wakeups_idle";
+    case counterWakeupLogind: return "wakeups_logind";
+    case counterWakeupConfig: return "wakeups_config";
+    default: ;
+    }
+    return "unknown";
+}
+
+QVariantMap PowerMetrics::Counters()
+{
+    QVariantMap result;
+    for (int i=0;i<counterCount;++i) { result[counterName((Counter)i)] = value((Counter)i); }
+    if (xcon) {
+        result["wakeups_x"] = xcon->wakeups();
+        result["x_round_trips"] = xcon->roundTrips();
+    }
+    result["inhibited"] = isInhibited;
+    return result;
+}
+
+QVariantMap PowerMetrics::Histograms()
+{
+    QVariantMap result;
+    for (int i=0;i<histogramCount;++i) {
+        result[QString("%1%2").arg(histogramNames[i]).arg(histogramUnits[i])] = histograms[i].toMap();
+    }
+    if (xcon) { result["x_round_trip_us"] = xcon->roundTripHistogram().toMap(); }
+    if (lidTrace) { result["lid_latency_us"] = lidTrace->toMap(); }
+    return result;
+}
+
+// text exposition format, times in seconds
+QString PowerMetrics::Prometheus()
+{
+    QString result;
+    for (int i=0;i<counterCount;++i) {
+        QString name = QString("%1%2_total").arg(METRICS_PREFIX).arg(counterName((Counter)i));
+        result.append(QString("# TYPE %1 counter\n%1 %2\n").arg(name).arg(value((Counter)i)));
+    }
+    result.append(QString("# TYPE %1inhibited gauge\n%1inhibited %2\n").arg(METRICS_PREFIX).arg(isInhibited?1:0));
+    for (int i=0;i<histogramCount;++i) {
+        QString name = QString("%1%2_seconds").arg(METRICS_PREFIX).arg(histogramNames[i]);
+        result.append(QString("# TYPE %1 histogram\n").arg(name));
+        appendHistogram(&result, name, QString(), histograms[i], histogramScales[i]);
+    }
+    if (xcon) {
+        result.append(QString("# TYPE %1wakeups_x_total counter\n%1wakeups_x_total %2\n").arg(METRICS_PREFIX).arg(xcon->wakeups()));
+        QString name = QString("%1x_round_trip_seconds").arg(METRICS_PREFIX);
+        result.append(QString("# TYPE %1 histogram\n").arg(name));
+        appendHistogram(&result, name, QString(), xcon->roundTripHistogram(), 0.000001);
+    }
+    if (lidTrace) {
+        QString name = QString("%1lid_latency_seconds").arg(METRICS_PREFIX);
+        result.append(QString("# TYPE %1 histogram\n").arg(name));
+        for (int i=0;i<LatencyTrace::pointCount;++i) {
+            LatencyTrace::Point point = (LatencyTrace::Point)i;
+            appendHistogram(&result, name, QString("point=\"%1\"").arg(LatencyTrace::pointName(point)),
+                            lidTrace->histogram(point), 0.000001);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef POWERMETRICS_H
+#define POWERMETRICS_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QVariant>
+
+#include "latencytrace.h"
+#include "xconnection.h"
+
+// org.lumina.PowerManager.Metrics, counters and histograms for the daemon.
+// counters are atomic, histograms are only written from the event loop,
+// so a read is a plain copy and never waits.
+class PowerMetrics : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.lumina.PowerManager.Metrics")
+
+public:
+    enum Counter
+    {
+        counterSuspendRequests,
+        counterHibernateRequests,
+        counterShutdownRequests,
+        counterLockRequests,
+        counterSleepEntered,
+        counterResumed,
+        counterLidClosed,
+        counterLidOpened,
+        counterHotplugEvents,
+        counterHotplugChanges,
+        counterIconRedraws,
+        counterSettingsReloads,
+        counterInhibitions,
+        counterStateUpdates,
+        counterStateMerged,
+        counterStateUnchanged,
+        counterWakeupUPower,
+        counterWakeupSysfs,
+        counterWakeupIdle,
+        counterWakeupLogind,
+        counterWakeupConfig,
+        counterCount
+    };
+    enum Histogram
+    {
+        histogramHotplugApply,
+        histogramInhibit,
+        histogramCheck,
+        histogramCount
+    };
+
+    explicit PowerMetrics(QObject *parent = NULL);
+    void add(Counter counter, int value = 1);
+    int value(Counter counter);
+    void addSample(Histogram histogram, qint64 value);
+    void setInhibited(bool inhibited);
+    void setConnection(XConnection *connection);
+    void setLidTrace(LatencyTrace *trace);
+    static const char *counterName(Counter counter);
+
+private:
+    QAtomicInt counters[counterCount];
+    LatencyHistogram histograms[histogramCount];
+    bool isInhibited;
+    QElapsedTimer inhibitTimer;
+    XConnection *xcon;
+    LatencyTrace *lidTrace;
+
+public slots:
+    QVariantMap Counters();
+    QVariantMap Histograms();
+    QString Prometheus();
+};
+
+#endif // POWERMETRICS_H
@@ -0,0 +1,157 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "powerservice.h"
+#include "tracering.h"
+#include <QDebug>
+
+PowerService::PowerService(QObject *parent) :
+    QObject(parent)
+  , history(NULL)
+  , lidTrace(NULL)
+  , supply(NULL)
+  , inhibitors(NULL)
+{
+}
+
+void PowerService::setHistory(BatteryHistory *batteryHistory)
+{
+    history = batteryHistory;
+}
+
+void PowerService::setLidTrace(LatencyTrace *trace)
+{
+    lidTrace = trace;
+}
+
+// NULL when the sysfs backend is off
+void PowerService::setPowerSupply(PowerSupply *powerSupply)
+{
+    supply = powerSupply;
+}
+
+void PowerService::setInhibitRegistry(InhibitRegistry *registry)
+{
+    inhibitors = registry;
+}
+
+// last published state, StateChanged is only emitted when it differs
+bool PowerService::setState(const QVariantMap &current)
+{
+    if (current == state) { return false; }
+    state = current;
+    emit StateChanged(state);
+    return true;
+}
+
+void PowerService::notify(const QString &title, const QString &message)
+{
+    emit Notify(title, message);
+}
+
+// only the first time a milestone is reached counts
+void PowerService::setStartupTime(const QString &point, qint64 msec)
+{
+    if (startup.contains(point)) { return; }
+    startup[point] = msec;
+}
+
+// changed settings from the settings dialog, already saved to disk
+// false if a key is not a power setting, the known ones are still applied
+bool PowerService::ApplySettings(const QVariantMap &settings)
+{
+    if (settings.isEmpty()) { return true; }
+    bool result = true;
+    PowerConfig check;
+    QMapIterator<QString, QVariant> i(settings);
+    while (i.hasNext()) {
+        i.next();
+        if (check.setValue(i.key(), i.value())<0) {
+            qWarning() << "unknown setting" << i.key();
+            result = false;
+        }
+    }
+    emit settingsChanged(settings);
+    return result;
+}
+
+// battery percent, power source and band for tray clients
+QVariantMap PowerService::State()
+{
+    return state;
+}
+
+// smoothed estimate in seconds, -1 if unknown
+qlonglong PowerService::TimeToEmpty()
+{
+    if (!history) { return -1; }
+    return history->timeToEmpty();
+}
+
+qlonglong PowerService::TimeToFull()
+{
+    if (!history) { return -1; }
+    return history->timeToFull();
+}
+
+// percent per hour
+double PowerService::DischargeRate()
+{
+    if (!history) { return 0; }
+    return history->dischargeRate();
+}
+
+double PowerService::ChargeRate()
+{
+    if (!history) { return 0; }
+    return history->chargeRate();
+}
+
+// histograms of the time from lid close to each tracepoint
+QVariantMap PowerService::LidLatency()
+{
+    if (!lidTrace) { return QVariantMap(); }
+    return lidTrace->toMap();
+}
+
+// per battery state from the sysfs backend, energy in Wh and rate in W
+QVariantList PowerService::Batteries()
+{
+    QVariantList result;
+    if (!supply) { return result; }
+    const PowerSnapshot &snapshot = supply->snapshot();
+    for (int i=0;i<snapshot.batteries.size();++i) { result << snapshot.batteries.at(i).toMap(); }
+    return result;
+}
+
+// total W, positive when discharging
+double PowerService::Rate()
+{
+    if (!supply) { return 0; }
+    return supply->snapshot().rate;
+}
+
+// msec from start to service registered, first battery state and deferred X setup
+QVariantMap PowerService::Startup()
+{
+    return startup;
+}
+
+// binary trace ring dump, decode with lumina-trace
+QByteArray PowerService::Trace()
+{
+    return TraceRing::dump();
+}
+
+// held inhibitors, with owner and how long they have been held
+QVariantList PowerService::Inhibitors()
+{
+    if (!inhibitors) { return QVariantList(); }
+    return inhibitors->toList();
+}
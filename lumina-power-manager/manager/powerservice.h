@@ -0,0 +1,65 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef POWERSERVICE_H
+#define POWERSERVICE_H
+
+#include <QObject>
+#include <QVariant>
+
+#include "batteryhistory.h"
+#include "latencytrace.h"
+#include "powersupply.h"
+#include "inhibitregistry.h"
+
+// org.lumina.PowerManager session service
+class PowerService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.lumina.PowerManager")
+
+public:
+    explicit PowerService(QObject *parent = NULL);
+    void setHistory(BatteryHistory *batteryHistory);
+    void setLidTrace(LatencyTrace *trace);
+    void setPowerSupply(PowerSupply *powerSupply);
+    void setInhibitRegistry(InhibitRegistry *registry);
+    bool setState(const QVariantMap &current);
+    void notify(const QString &title, const QString &message);
+    void setStartupTime(const QString &point, qint64 msec);
+
+private:
+    BatteryHistory *history;
+    LatencyTrace *lidTrace;
+    PowerSupply *supply;
+    InhibitRegistry *inhibitors;
+    QVariantMap state;
+    QVariantMap startup;
+
+signals:
+    void settingsChanged(const QVariantMap &settings);
+    Q_SCRIPTABLE void StateChanged(const QVariantMap &state);
+    Q_SCRIPTABLE void Notify(const QString &title, const QString &message);
+
+public slots:
+    bool ApplySettings(const QVariantMap &settings);
+    QVariantMap State();
+    qlonglong TimeToEmpty();
+    qlonglong TimeToFull();
+    double DischargeRate();
+    double ChargeRate();
+    QVariantMap LidLatency();
+    QVariantList Batteries();
+    double Rate();
+    QVariantMap Startup();
+    QByteArray Trace();
+    QVariantList Inhibitors();
+};
+
+#endif // POWERSERVICE_H
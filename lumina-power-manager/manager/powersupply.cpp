@@ -0,0 +1,314 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "powersupply.h"
+
+#include <QDir>
+#include <QStringList>
+#include <QFile>
+#include <QDateTime>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <linux/netlink.h>
+#endif
+
+static int openAttribute(const QString &path)
+{
+    return open(QFile::encodeName(path).constData(), O_RDONLY|O_CLOEXEC);
+}
+
+// read the whole (small) attribute from the start
+static QByteArray readAttribute(int fd)
+{
+    if (fd<0) { return QByteArray(); }
+    char buffer[64];
+    ssize_t size = pread(fd, buffer, sizeof(buffer)-1, 0);
+    if (size<=0) { return QByteArray(); }
+    return QByteArray(buffer, size).trimmed();
+}
+
+static qint64 readNumber(int fd, qint64 fallback = 0)
+{
+    bool ok = false;
+    qint64 result = readAttribute(fd).toLongLong(&ok);
+    return ok?result:fallback;
+}
+
+static void closeAttribute(int *fd)
+{
+    if (*fd>=0) { close(*fd); }
+    *fd = -1;
+}
+
+PowerSupply::PowerSupply(const QString &sysfsRoot, QObject *parent) :
+    QObject(parent)
+  , root(sysfsRoot)
+  , uevent(-1)
+  , notifier(0)
+  , poll(0)
+{
+#ifdef Q_OS_LINUX
+    // kernel uevents, only meaningful for the real sysfs
+    if (root == POWER_SUPPLY_SYSFS) {
+        uevent = socket(AF_NETLINK, SOCK_DGRAM|SOCK_CLOEXEC|SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+        if (uevent>=0) {
+            struct sockaddr_nl addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.nl_family = AF_NETLINK;
+            addr.nl_groups = 1;
+            if (bind(uevent, (struct sockaddr*)&addr, sizeof(addr))<0) { closeAttribute(&uevent); }
+        }
+        if (uevent>=0) {
+            notifier = new QSocketNotifier(uevent, QSocketNotifier::Read, this);
+            connect(notifier, SIGNAL(activated(int)), this, SLOT(handleUevent()));
+        }
+    }
+#endif
+
+    poll = new QTimer(this);
+    poll->setInterval(POWER_SUPPLY_POLL);
+    connect(poll, SIGNAL(timeout()), this, SLOT(refresh()));
+    poll->start();
+
+    scan();
+    refresh();
+}
+
+PowerSupply::~PowerSupply()
+{
+    closeDevices();
+    if (notifier) { notifier->setEnabled(false); }
+    closeAttribute(&uevent);
+}
+
+bool PowerSupply::isValid()
+{
+    return !devices.isEmpty();
+}
+
+// latest snapshot, consumers read this instead of asking the backend
+const PowerSnapshot &PowerSupply::snapshot() const
+{
+    return current;
+}
+
+// open the attribute files of all supplies
+void PowerSupply::scan()
+{
+    closeDevices();
+    QDir dir(root);
+    QStringList names = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot|QDir::System, QDir::Name);
+    for (int i=0;i<names.size();++i) {
+        QString path = QString("%1/%2").arg(root).arg(names.at(i));
+        QFile type(QString("%1/type").arg(path));
+        if (!type.open(QIODevice::ReadOnly)) { continue; }
+        QByteArray kind = type.readAll().trimmed();
+        if (kind != "Battery" && kind != "UPS" && kind != "Mains") { continue; }
+        // peripheral batteries (HID, Bluetooth) don't power the system
+        QFile scope(QString("%1/scope").arg(path));
+        if (scope.open(QIODevice::ReadOnly) && scope.readAll().trimmed() == "Device") { continue; }
+
+        PowerSupplyDevice device;
+        device.name = names.at(i);
+        device.battery = kind != "Mains";
+        device.slot = -1;
+        device.mainsOnline = false;
+        device.online = openAttribute(QString("%1/online").arg(path));
+        device.present = openAttribute(QString("%1/present").arg(path));
+        device.capacity = openAttribute(QString("%1/capacity").arg(path));
+        device.status = openAttribute(QString("%1/status").arg(path));
+        device.charge = !QFile::exists(QString("%1/energy_now").arg(path));
+        QString prefix = device.charge?"charge":"energy";
+        device.energyNow = openAttribute(QString("%1/%2_now").arg(path).arg(prefix));
+        device.energyFull = openAttribute(QString("%1/%2_full").arg(path).arg(prefix));
+        device.powerNow = openAttribute(QString("%1/%2").arg(path).arg(device.charge?"current_now":"power_now"));
+        device.voltageNow = openAttribute(QString("%1/voltage_now").arg(path));
+        devices << device;
+    }
+}
+
+void PowerSupply::closeDevices()
+{
+    for (int i=0;i<devices.size();++i) {
+        PowerSupplyDevice &device = devices[i];
+        closeAttribute(&device.online);
+        closeAttribute(&device.present);
+        closeAttribute(&device.capacity);
+        closeAttribute(&device.status);
+        closeAttribute(&device.energyNow);
+        closeAttribute(&device.energyFull);
+        closeAttribute(&device.powerNow);
+        closeAttribute(&device.voltageNow);
+    }
+    devices.clear();
+}
+
+BatteryState PowerSupply::readBattery(const PowerSupplyDevice &device)
+{
+    BatteryState battery;
+    battery.name = device.name;
+    battery.present = readNumber(device.present, 1) == 1;
+    if (!battery.present) { return battery; }
+    QByteArray status = readAttribute(device.status);
+    battery.charging = status == "Charging";
+    battery.discharging = status == "Discharging";
+
+    // uWh, or uAh times uV
+    double scale = 1000000.0;
+    if (device.charge) {
+        qint64 voltage = readNumber(device.voltageNow, 1000000);
+        scale = 1000000.0*1000000.0/(double)(voltage>0?voltage:1000000);
+    }
+    battery.energy = readNumber(device.energyNow)/scale;
+    battery.energyFull = readNumber(device.energyFull)/scale;
+    battery.power = qAbs(readNumber(device.powerNow))/scale;
+    if (!battery.charging && !battery.discharging) { battery.power = 0; }
+
+    qint64 capacity = readNumber(device.capacity, -1);
+    if (battery.energyFull>0) { battery.percent = battery.energy*100.0/battery.energyFull; }
+    else if (capacity>=0) { battery.percent = capacity; }
+    return battery;
+}
+
+// derived fields, the totals are kept up to date by the caller
+void PowerSupply::finish(PowerSnapshot *snapshot)
+{
+    snapshot->timestamp = QDateTime::currentMSecsSinceEpoch();
+    snapshot->valid = !devices.isEmpty();
+
+    bool mains = false;
+    bool online = false;
+    for (int i=0;i<devices.size();++i) {
+        if (devices.at(i).battery) { continue; }
+        mains = true;
+        if (devices.at(i).mainsOnline) { online = true; }
+    }
+    if (mains) { snapshot->onBattery = !online; }
+    else {
+        // no mains supply (UPS only), trust the battery status
+        snapshot->onBattery = false;
+        for (int i=0;i<snapshot->batteries.size();++i) {
+            if (snapshot->batteries.at(i).discharging) { snapshot->onBattery = true; }
+        }
+    }
+
+    // sum of energy, batteries that only report capacity count as an
+    // average sized one. capacity average if none of them report energy
+    int withEnergy = 0;
+    for (int i=0;i<snapshot->batteries.size();++i) {
+        if (snapshot->batteries.at(i).present && snapshot->batteries.at(i).energyFull>0) { withEnergy++; }
+    }
+    if (withEnergy>0 && snapshot->energyFull>0) {
+        double energy = snapshot->energy;
+        double energyFull = snapshot->energyFull;
+        double average = snapshot->energyFull/withEnergy;
+        for (int i=0;i<snapshot->batteries.size();++i) {
+            const BatteryState &battery = snapshot->batteries.at(i);
+            if (!battery.present || battery.energyFull>0) { continue; }
+            energy += average*battery.percent/100.0;
+            energyFull += average;
+        }
+        snapshot->percent = qBound(0.0, energy*100.0/energyFull, 100.0);
+        return;
+    }
+    double sum = 0;
+    int count = 0;
+    for (int i=0;i<snapshot->batteries.size();++i) {
+        if (!snapshot->batteries.at(i).present) { continue; }
+        sum += snapshot->batteries.at(i).percent;
+        count++;
+    }
+    snapshot->percent = count>0?sum/count:0;
+}
+
+void PowerSupply::update(const PowerSnapshot &next)
+{
+    bool same = next.onBattery == current.onBattery && next.percent == current.percent &&
+                next.rate == current.rate && next.batteries == current.batteries;
+    current = next;
+    if (!same) { emit changed(); }
+}
+
+// read all supplies
+void PowerSupply::refresh()
+{
+    PowerSnapshot next;
+    for (int i=0;i<devices.size();++i) {
+        PowerSupplyDevice &device = devices[i];
+        if (!device.battery) {
+            device.mainsOnline = readNumber(device.online) == 1;
+            continue;
+        }
+        BatteryState battery = readBattery(device);
+        device.slot = next.batteries.size();
+        next.batteries << battery;
+        next.energy += battery.energy;
+        next.energyFull += battery.energyFull;
+        next.rate += battery.rate();
+    }
+    finish(&next);
+    update(next);
+}
+
+// read one supply and adjust the totals, the others are not touched
+void PowerSupply::refreshDevice(const QString &name)
+{
+    for (int i=0;i<devices.size();++i) {
+        PowerSupplyDevice &device = devices[i];
+        if (device.name != name) { continue; }
+        PowerSnapshot next = current;
+        if (device.battery && device.slot>=0 && device.slot<next.batteries.size()) {
+            BatteryState old = next.batteries.at(device.slot);
+            BatteryState battery = readBattery(device);
+            next.energy += battery.energy-old.energy;
+            next.energyFull += battery.energyFull-old.energyFull;
+            next.rate += battery.rate()-old.rate();
+            next.batteries[device.slot] = battery;
+        } else if (!device.battery) {
+            device.mainsOnline = readNumber(device.online) == 1;
+        } else {
+            refresh();
+            return;
+        }
+        finish(&next);
+        update(next);
+        return;
+    }
+}
+
+// drain all queued uevents, only changed supplies are read again
+void PowerSupply::handleUevent()
+{
+    QStringList changedDevices;
+    bool rescan = false;
+    char buffer[4096];
+    ssize_t size;
+    while ((size = recv(uevent, buffer, sizeof(buffer)-1, 0))>0) {
+        buffer[size] = 0;
+        // header "action@devpath" then NUL separated KEY=value
+        QByteArray message(buffer, size);
+        if (!message.contains("SUBSYSTEM=power_supply")) { continue; }
+        QByteArray header(buffer);
+        if (header.startsWith("add@") || header.startsWith("remove@")) { rescan = true; }
+        QString name = QString::fromLocal8Bit(header.mid(header.lastIndexOf('/')+1));
+        if (!changedDevices.contains(name)) { changedDevices << name; }
+    }
+    if (rescan) {
+        scan();
+        refresh();
+        return;
+    }
+    for (int i=0;i<changedDevices.size();++i) { refreshDevice(changedDevices.at(i)); }
+}
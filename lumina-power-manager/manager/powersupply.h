@@ -0,0 +1,152 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef POWERSUPPLY_H
+#define POWERSUPPLY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QTimer>
+
+#include "common.h"
+
+class QSocketNotifier;
+
+// not all batteries send uevents on capacity changes
+#define POWER_SUPPLY_POLL 30000
+
+// state of one battery (or UPS), energy in Wh and power in W (0 if unknown)
+struct BatteryState
+{
+    QString name;
+    bool present;
+    bool charging;
+    bool discharging;
+    double percent;
+    double energy;
+    double energyFull;
+    double power;
+
+    BatteryState()
+        : present(false)
+        , charging(false)
+        , discharging(false)
+        , percent(0)
+        , energy(0)
+        , energyFull(0)
+        , power(0)
+    {
+    }
+    // W, positive when discharging
+    double rate() const
+    {
+        return charging?-power:power;
+    }
+    QVariantMap toMap() const
+    {
+        QVariantMap result;
+        result["name"] = name;
+        result["present"] = present;
+        result["percent"] = percent;
+        result["energy"] = energy;
+        result["energy_full"] = energyFull;
+        result["rate"] = rate();
+        return result;
+    }
+    bool operator==(const BatteryState &other) const
+    {
+        return name == other.name && present == other.present && charging == other.charging &&
+               discharging == other.discharging && percent == other.percent && energy == other.energy &&
+               energyFull == other.energyFull && power == other.power;
+    }
+};
+
+// one consistent read of all power supplies, never changed after it is built.
+// percent is weighted by energy when the batteries report it, the totals
+// only cover batteries with energy.
+struct PowerSnapshot
+{
+    bool valid;
+    bool onBattery;
+    double percent;
+    double energy;
+    double energyFull;
+    double rate;
+    qint64 timestamp;
+    QList<BatteryState> batteries;
+
+    PowerSnapshot()
+        : valid(false)
+        , onBattery(false)
+        , percent(0)
+        , energy(0)
+        , energyFull(0)
+        , rate(0)
+        , timestamp(0)
+    {
+    }
+};
+
+// attribute files of one power supply, kept open and read with pread
+struct PowerSupplyDevice
+{
+    QString name;
+    bool battery;
+    int slot; // index in PowerSnapshot::batteries
+    bool mainsOnline;
+    int online;
+    int present;
+    int capacity;
+    int status;
+    int energyNow;
+    int energyFull;
+    int powerNow;
+    int voltageNow;
+    bool charge; // charge_* in uAh instead of energy_* in uWh
+};
+
+// power supply backend reading sysfs directly, no D-Bus involved.
+// changes are picked up from kernel uevents (and a slow poll),
+// the root is configurable so it can run against a fixture tree.
+class PowerSupply : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PowerSupply(const QString &sysfsRoot = POWER_SUPPLY_SYSFS, QObject *parent = NULL);
+    ~PowerSupply();
+    bool isValid();
+    const PowerSnapshot &snapshot() const;
+
+private:
+    QString root;
+    QList<PowerSupplyDevice> devices;
+    PowerSnapshot current;
+    int uevent;
+    QSocketNotifier *notifier;
+    QTimer *poll;
+    void scan();
+    void closeDevices();
+    BatteryState readBattery(const PowerSupplyDevice &device);
+    void finish(PowerSnapshot *snapshot);
+    void update(const PowerSnapshot &next);
+
+signals:
+    void changed();
+
+public slots:
+    void refresh();
+    void refreshDevice(const QString &name);
+
+private slots:
+    void handleUevent();
+};
+
+#endif // POWERSUPPLY_H
@@ -0,0 +1,204 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "profilestore.h"
+#include "common.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QStringList>
+#include <QDateTime>
+#include <QDebug>
+
+#include <stdio.h>
+#include <unistd.h>
+
+static QDataStream &operator<<(QDataStream &stream, const LayoutOutput &output)
+{
+    stream << output.name << output.enabled << output.size << (qint32)output.refresh
+           << output.pos << (qint32)output.rotation << output.primary;
+    return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, LayoutOutput &output)
+{
+    qint32 refresh, rotation;
+    stream >> output.name >> output.enabled >> output.size >> refresh
+           >> output.pos >> rotation >> output.primary;
+    output.refresh = refresh;
+    output.rotation = rotation;
+    return stream;
+}
+
+ProfileStore::ProfileStore(const QString &fileName)
+    : file(fileName)
+{
+    load();
+}
+
+// next to the settings file
+QString ProfileStore::fileName()
+{
+    return QString("%1/lumina-power-displays.dat").arg(QFileInfo(PowerConfig::fileName()).absolutePath());
+}
+
+QString ProfileStore::monitorId(const TopologyOutput &output)
+{
+    if (output.edid.isEmpty()) { return QString("name:%1").arg(output.name); }
+    return QString("%1@%2").arg(QString::fromLatin1(QCryptographicHash::hash(output.edid, QCryptographicHash::Md5).toHex()))
+                           .arg(output.name);
+}
+
+// sorted ids of all connected monitors
+QString ProfileStore::key(const Topology &topology)
+{
+    QStringList ids;
+    QMapIterator<QString, TopologyOutput> i(topology.outputs);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().connected) { ids << monitorId(i.value()); }
+    }
+    ids.sort();
+    return ids.join(",");
+}
+
+int ProfileStore::size()
+{
+    return profiles.size();
+}
+
+// saved layout for the connected monitors mapped to the current
+// output names, empty if the set is unknown
+DisplayLayout ProfileStore::restore(const Topology &topology)
+{
+    DisplayLayout result;
+    QString id = key(topology);
+    QHash<QString, DisplayLayout>::const_iterator profile = profiles.constFind(id);
+    if (profile == profiles.constEnd()) { return result; }
+    used[id] = QDateTime::currentMSecsSinceEpoch();
+
+    QMapIterator<QString, TopologyOutput> i(topology.outputs);
+    while (i.hasNext()) {
+        i.next();
+        if (!i.value().connected) { continue; }
+        LayoutOutput output = profile.value().outputs.value(monitorId(i.value()));
+        output.name = i.key();
+        result.outputs[i.key()] = output;
+    }
+    return result;
+}
+
+// save layout for the connected monitors, only written if changed
+bool ProfileStore::store(const Topology &topology, const DisplayLayout &layout)
+{
+    QString id = key(topology);
+    if (id.isEmpty() || layout.isEmpty()) { return false; }
+
+    DisplayLayout profile;
+    QMapIterator<QString, LayoutOutput> i(layout.outputs);
+    while (i.hasNext()) {
+        i.next();
+        const TopologyOutput &output = topology.outputs.value(i.key());
+        if (!output.connected) { continue; }
+        LayoutOutput saved = i.value();
+        saved.name = monitorId(output);
+        profile.outputs[saved.name] = saved;
+    }
+    if (profiles.contains(id) && profiles.value(id).outputs == profile.outputs) { return false; }
+    profiles[id] = profile;
+    used[id] = QDateTime::currentMSecsSinceEpoch();
+    evict();
+    qDebug() << "saved display profile" << id;
+    return save();
+}
+
+// drop the least recently used profiles over PROFILE_STORE_MAX
+void ProfileStore::evict()
+{
+    while (profiles.size()>PROFILE_STORE_MAX) {
+        QString oldest;
+        qint64 last = 0;
+        QHashIterator<QString, DisplayLayout> i(profiles);
+        while (i.hasNext()) {
+            i.next();
+            qint64 time = used.value(i.key());
+            if (oldest.isEmpty() || time<last) {
+                oldest = i.key();
+                last = time;
+            }
+        }
+        qDebug() << "dropped display profile" << oldest;
+        profiles.remove(oldest);
+        used.remove(oldest);
+    }
+}
+
+void ProfileStore::load()
+{
+    QFile data(file);
+    if (!data.open(QIODevice::ReadOnly)) { return; }
+    QDataStream stream(&data);
+    stream.setVersion(QDataStream::Qt_4_6);
+    quint32 magic, version, count;
+    stream >> magic >> version;
+    // version 1 ids have no connector, they would never match
+    if (magic != PROFILE_STORE_MAGIC || version != PROFILE_STORE_VERSION) { return; }
+    stream >> count;
+    for (quint32 i=0;i<count && stream.status() == QDataStream::Ok;++i) {
+        QString id;
+        quint32 outputs;
+        qint64 last;
+        stream >> id >> last >> outputs;
+        DisplayLayout profile;
+        for (quint32 j=0;j<outputs && stream.status() == QDataStream::Ok;++j) {
+            LayoutOutput output;
+            stream >> output;
+            profile.outputs[output.name] = output;
+        }
+        if (stream.status() == QDataStream::Ok) {
+            profiles[id] = profile;
+            used[id] = last;
+        }
+    }
+    evict();
+}
+
+// write to a temp file and rename(2) it over the index, a crash leaves
+// either the old or the new index
+bool ProfileStore::save()
+{
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QString temp = file+".tmp";
+    QFile data(temp);
+    if (!data.open(QIODevice::WriteOnly|QIODevice::Truncate)) { return false; }
+    QDataStream stream(&data);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << (quint32)PROFILE_STORE_MAGIC << (quint32)PROFILE_STORE_VERSION << (quint32)profiles.size();
+    QHashIterator<QString, DisplayLayout> i(profiles);
+    while (i.hasNext()) {
+        i.next();
+        stream << i.key() << used.value(i.key()) << (quint32)i.value().outputs.size();
+        QMapIterator<QString, LayoutOutput> j(i.value().outputs);
+        while (j.hasNext()) {
+            j.next();
+            stream << j.value();
+        }
+    }
+    data.flush();
+    bool ok = stream.status() == QDataStream::Ok && fsync(data.handle()) == 0;
+    data.close();
+    if (!ok) {
+        QFile::remove(temp);
+        return false;
+    }
+    return rename(QFile::encodeName(temp).constData(), QFile::encodeName(file).constData()) == 0;
+}
@@ -0,0 +1,48 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+
+#include <QString>
+#include <QHash>
+
+#include "topology.h"
+#include "layout.h"
+
+#define PROFILE_STORE_MAGIC 0x4c504d44
+#define PROFILE_STORE_VERSION 2
+// profiles kept, the least recently used one is dropped first
+#define PROFILE_STORE_MAX 32
+
+// saved display layouts keyed by the set of connected monitors.
+// monitors are identified by a hash of their EDID and the connector,
+// two identical monitors are still two monitors.
+// the whole index is kept in memory and written on change.
+class ProfileStore
+{
+public:
+    explicit ProfileStore(const QString &fileName);
+    static QString fileName();
+    static QString monitorId(const TopologyOutput &output);
+    static QString key(const Topology &topology);
+    int size();
+    DisplayLayout restore(const Topology &topology);
+    bool store(const Topology &topology, const DisplayLayout &layout);
+
+private:
+    QString file;
+    QHash<QString, DisplayLayout> profiles;
+    QHash<QString, qint64> used;
+    void load();
+    void evict();
+    bool save();
+};
+
+#endif // PROFILESTORE_H
@@ -6,453 +6,230 @@
 */
 
 #include "systray.h"
+#include <QApplication>
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusArgument>
 
 SysTray::SysTray(QObject *parent)
     : QObject(parent)
     , tray(0)
-    , man(0)
-    , pm(0)
-    , ss(0)
-    , ht(0)
-    , wasLowBattery(false)
-    , lowBatteryValue(LOW_BATTERY)
-    , critBatteryValue(CRITICAL_BATTERY)
-    , hasService(false)
-    , lidActionBattery(LID_BATTERY_DEFAULT)
-    , lidActionAC(LID_AC_DEFAULT)
-    , criticalAction(CRITICAL_DEFAULT)
-    , autoSleepBattery(AUTO_SLEEP_BATTERY)
-    , autoSleepAC(0)
-    , timer(0)
-    , timeouts(0)
-    , showNotifications(true)
-    , desktopSS(true)
-    , desktopPM(true)
-    , showBatteryPercent(true)
-    , showTray(true)
-    , disableLidACOnExternalMonitors(true)
-    , disableLidBatteryOnExternalMonitors(true)
-{
-    // setup tray
-    tray = new QSystemTrayIcon(QIcon::fromTheme(DEFAULT_BATTERY_ICON, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON))), this);
-    connect(tray, SIGNAL(activated(QSystemTrayIcon::ActivationReason)), this, SLOT(trayActivated(QSystemTrayIcon::ActivationReason)));
-    if (tray->isSystemTrayAvailable()) { tray->show(); }
-
-    // setup manager
-    man = new Power(this);
-    connect(man, SIGNAL(updatedDevices()), this, SLOT(checkDevices()));
-    connect(man, SIGNAL(closedLid()), this, SLOT(handleClosedLid()));
-    connect(man, SIGNAL(openedLid()), this, SLOT(handleOpenedLid()));
-    connect(man, SIGNAL(switchedToBattery()), this, SLOT(handleOnBattery()));
-    connect(man, SIGNAL(switchedToAC()), this, SLOT(handleOnAC()));
-
-    // setup org.freedesktop.PowerManagement
-    pm = new PowerManagement();
-    connect(pm, SIGNAL(HasInhibitChanged(bool)), this, SLOT(handleHasInhibitChanged(bool)));
-    connect(pm, SIGNAL(update()), this, SLOT(loadSettings()));
-
-    // setup org.freedesktop.ScreenSaver
-    ss = new ScreenSaver();
-
-    // setup monitor hotplug watcher
-    ht = new HotPlug();
-    qRegisterMetaType<QMap<QString,bool> >("QMap<QString,bool>");
-    connect(ht, SIGNAL(status(QString,bool)), this, SLOT(handleDisplay(QString,bool)));
-    connect(ht, SIGNAL(found(QMap<QString,bool>)), this, SLOT(handleFoundDisplays(QMap<QString,bool>)));
-    ht->requestScan();
-
-    // setup timer
-    timer = new QTimer(this);
-    timer->setInterval(60000);
-    connect(timer, SIGNAL(timeout()), this, SLOT(timeout()));
-    timer->start();
-
-    // load settings and register service
-    loadSettings();
-    registerService();
-    QTimer::singleShot(1000, this, SLOT(checkDevices()));
-}
-
+    , daemon(0)
+    , watcher(0)
+    , serviceWatcher(0)
+    , viewUpdates(0)
+    , viewSkipped(0)
+{
+    // tray settings only, the daemon has its own watcher
+    watcher = new ConfigWatcher(PowerConfig::fileName(), this);
+    connect(watcher, SIGNAL(changed()), this, SLOT(loadSettings()));
+    config = PowerConfig::load();
+
+    // follow lumina-power-daemon if running, else run it here
+    if (PowerDaemon::isRunning()) {
+        qDebug() << "using running power daemon";
+        serviceWatcher = new QDBusServiceWatcher(LPM_SERVICE, QDBusConnection::sessionBus(),
+                                                 QDBusServiceWatcher::WatchForRegistration |
+                                                 QDBusServiceWatcher::WatchForUnregistration, this);
+        connect(serviceWatcher, SIGNAL(serviceRegistered(QString)), this, SLOT(handleServiceRegistered(QString)));
+        connect(serviceWatcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(handleServiceUnregistered(QString)));
+        connectDaemon();
+    } else { startDaemon(); }
+}
+
+// update counts once on exit, not per update
 SysTray::~SysTray()
 {
-    man->deleteLater();
-    pm->deleteLater();
-    ss->deleteLater();
-    ht->deleteLater();
-}
-
-// what to do when user clicks systray, at the moment nothing
-void SysTray::trayActivated(QSystemTrayIcon::ActivationReason reason)
-{
-    Q_UNUSED(reason)
-    /*switch(reason) {
-    case QSystemTrayIcon::Context:
-    case QSystemTrayIcon::Trigger:
-        //if (menu->actions().size()>0) { menu->popup(QCursor::pos()); }
-    default:;
-    }*/
-}
-
-void SysTray::checkDevices()
-{
-    if (tray->isSystemTrayAvailable() && !tray->isVisible() && showTray) { tray->show(); }
-    if (!showTray && tray->isVisible()) { tray->hide(); }
-
-    // get battery left and add tooltip
-    double batteryLeft = man->batteryLeft();
-    tray->setToolTip(tr("Battery at %1%").arg(batteryLeft));
-    if (batteryLeft==100) { tray->setToolTip(tr("Charged")); }
-    if (!man->onBattery() && batteryLeft<100) { tray->setToolTip(tray->toolTip().append(tr(" (Charging)"))); }
-
-    // draw battery systray
-    drawBattery(batteryLeft);
-
-    // critical battery?
-    if (batteryLeft<=(double)critBatteryValue && man->onBattery()) { handleCritical(); }
-
-    // Register service if not already registered
-    if (!hasService) { registerService(); }
+    qDebug() << "tray updates" << viewUpdates << "unchanged" << viewSkipped;
 }
 
-// what to do when user open/close lid
-void SysTray::handleClosedLid()
+// follow the state of lumina-power-daemon
+void SysTray::connectDaemon()
 {
-
-    qDebug() << "enabled video output" << monitors;
-    qDebug() << "internal monitor connected?" << internalMonitorIsConnected();
-    qDebug() << "has external monitor?" << externalMonitorIsConnected();
-
-    int type = lidNone;
-    if (man->onBattery()) {  // on battery
-        type = lidActionBattery;
-        if (disableLidBatteryOnExternalMonitors && externalMonitorIsConnected()) {
-            qDebug() << "external monitor is connected, ignore lid action";
-            return;
-        }
-    } else { // on ac
-        type = lidActionAC;
-        if (disableLidACOnExternalMonitors && externalMonitorIsConnected()) {
-            qDebug() << "external monitor is connected, ignore lid action";
-            return;
-        }
-    }
-    switch(type) {
-    case lidLock:
-        man->lockScreen();
-        break;
-    case lidSleep:
-        man->suspend();
-        break;
-    case lidHibernate:
-        man->hibernate();
-        break;
-    default: ;
-    }
+    QDBusConnection::sessionBus().connect(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, "StateChanged",
+                                          this, SLOT(handleState(QVariantMap)));
+    QDBusConnection::sessionBus().connect(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, "Notify",
+                                          this, SLOT(handleNotify(QString,QString)));
+    QDBusInterface iface(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, QDBusConnection::sessionBus());
+    iface.callWithCallback("State", QList<QVariant>(), this, SLOT(handleState(QVariantMap)));
 }
 
-// do something when lid is opened
-void SysTray::handleOpenedLid()
+void SysTray::disconnectDaemon()
 {
-    // do nothing
+    QDBusConnection::sessionBus().disconnect(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, "StateChanged",
+                                             this, SLOT(handleState(QVariantMap)));
+    QDBusConnection::sessionBus().disconnect(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, "Notify",
+                                             this, SLOT(handleNotify(QString,QString)));
 }
 
-// do something when switched to battery power
-void SysTray::handleOnBattery()
+// run the daemon here, unless lumina-power-daemon came back
+void SysTray::startDaemon()
 {
-    if (showNotifications && tray->isVisible()) {
-        tray->showMessage(tr("On Battery"), tr("Switched to battery power."));
+    if (daemon) { return; }
+    if (serviceWatcher && PowerDaemon::isRunning()) { return; }
+    qDebug() << "running power daemon in tray";
+    if (serviceWatcher) {
+        serviceWatcher->deleteLater();
+        serviceWatcher = 0;
     }
+    daemon = new PowerDaemon(this);
+    connect(daemon, SIGNAL(stateChanged(QVariantMap)), this, SLOT(handleState(QVariantMap)));
+    connect(daemon, SIGNAL(notify(QString,QString)), this, SLOT(handleNotify(QString,QString)));
 }
 
-// do something when switched to ac power
-void SysTray::handleOnAC()
+// lumina-power-daemon was restarted, subscribe again
+void SysTray::handleServiceRegistered(const QString &name)
 {
-    if (showNotifications && tray->isVisible()) {
-        tray->showMessage(tr("On AC"), tr("Switched to AC power."));
-    }
+    Q_UNUSED(name)
+    if (daemon) { return; }
+    qDebug() << "power daemon restarted";
+    disconnectDaemon();
+    connectDaemon();
 }
 
-// load default settings
-void SysTray::loadSettings()
+// lumina-power-daemon exited, give it a moment to restart
+void SysTray::handleServiceUnregistered(const QString &name)
 {
-    if (Common::validPowerSettings("autoSleepBattery")) {
-        autoSleepBattery = Common::loadPowerSettings("autoSleepBattery").toInt();
-    }
-    if (Common::validPowerSettings("autoSleepAC")) {
-        autoSleepAC = Common::loadPowerSettings("autoSleepAC").toInt();
-    }
-    if (Common::validPowerSettings("lowBattery")) {
-        lowBatteryValue = Common::loadPowerSettings("lowBattery").toInt();
-    }
-    if (Common::validPowerSettings("criticalBattery")) {
-        critBatteryValue = Common::loadPowerSettings("criticalBattery").toInt();
-    }
-    if (Common::validPowerSettings("lidBattery")) {
-        lidActionBattery = Common::loadPowerSettings("lidBattery").toInt();
-    }
-    if (Common::validPowerSettings("lidAC")) {
-        lidActionAC = Common::loadPowerSettings("lidAC").toInt();
-    }
-    if (Common::validPowerSettings("criticalAction")) {
-        criticalAction = Common::loadPowerSettings("criticalAction").toInt();
-    }
-    if (Common::validPowerSettings("desktop_ss")) {
-        desktopSS = Common::loadPowerSettings("desktop_ss").toBool();
-    }
-    if (Common::validPowerSettings("desktop_pm")) {
-        desktopPM = Common::loadPowerSettings("desktop_pm").toBool();
-    }
-    if (Common::validPowerSettings("tray_notify")) {
-        showNotifications = Common::loadPowerSettings("tray_notify").toBool();
-    }
-    if (Common::validPowerSettings("show_battery_percent")) {
-        showBatteryPercent = Common::loadPowerSettings("show_battery_percent").toBool();
-    }
-    if (Common::validPowerSettings("show_tray")) {
-        showTray = Common::loadPowerSettings("show_tray").toBool();
-    }
-    if (Common::validPowerSettings("disable_lid_action_battery_external_monitor")) {
-        disableLidBatteryOnExternalMonitors = Common::loadPowerSettings("disable_lid_action_battery_external_monitor").toBool();
-    }
-    if (Common::validPowerSettings("disable_lid_action_ac_external_monitor")) {
-        disableLidACOnExternalMonitors = Common::loadPowerSettings("disable_lid_action_ac_external_monitor").toBool();
-    }
-
-    qDebug() << "no lid action ac external monitor" << disableLidACOnExternalMonitors;
-    qDebug() << "no lid action battery external monitor" << disableLidBatteryOnExternalMonitors;
-    qDebug() << "show tray" << showTray;
-    qDebug() << "battery percent" << showBatteryPercent;
-    qDebug() << "tray notify" << showNotifications;
-    qDebug() << "desktop ss" << desktopSS;
-    qDebug() << "desktop pm" << desktopPM;
-    qDebug() << "auto sleep battery" << autoSleepBattery;
-    qDebug() << "auto sleep ac" << autoSleepAC;
-    qDebug() << "low battery setting" << lowBatteryValue;
-    qDebug() << "critical battery setting" << critBatteryValue;
-    qDebug() << "lid battery" << lidActionBattery;
-    qDebug() << "lid ac" << lidActionAC;
-    qDebug() << "critical action" << criticalAction;
+    Q_UNUSED(name)
+    if (daemon) { return; }
+    qDebug() << "power daemon exited";
+    disconnectDaemon();
+    QTimer::singleShot(TRAY_DAEMON_RESTART_WAIT, this, SLOT(startDaemon()));
 }
 
-// register session service
-void SysTray::registerService()
+// the tray is created with the first battery state,
+// so the first icon drawn is the real one
+void SysTray::setupTray()
 {
-    if (hasService) { return; }
-    if (!QDBusConnection::sessionBus().isConnected()) {
-        qWarning("Cannot connect to D-Bus.");
-        return;
-    }
-    if (desktopPM) {
-    if (!QDBusConnection::sessionBus().registerService(PM_SERVICE)) {
-        qWarning() << QDBusConnection::sessionBus().lastError().message();
-        return;
-    }
-        if (!QDBusConnection::sessionBus().registerObject(PM_PATH, pm, QDBusConnection::ExportAllContents)) {
-        qWarning() << QDBusConnection::sessionBus().lastError().message();
-        return;
-    }
-        qDebug() << "Enabled org.freedesktop.PowerManagement";
-    }
-    if (desktopSS) {
-        if (!QDBusConnection::sessionBus().registerService(SS_SERVICE)) {
-            qWarning() << QDBusConnection::sessionBus().lastError().message();
-            return;
-        }
-        if (!QDBusConnection::sessionBus().registerObject(SS_PATH, ss, QDBusConnection::ExportAllContents)) {
-            qWarning() << QDBusConnection::sessionBus().lastError().message();
-            return;
-        }
-        qDebug() << "Enabled org.freedesktop.ScreenSaver";
-    }
-    hasService = true;
+    tray = new QSystemTrayIcon(this);
+    connect(tray, SIGNAL(activated(QSystemTrayIcon::ActivationReason)), this, SLOT(trayActivated(QSystemTrayIcon::ActivationReason)));
 }
 
-// dbus session inhibit status handler
-void SysTray::handleHasInhibitChanged(bool has_inhibit)
+// what to do when user clicks systray, at the moment nothing
+void SysTray::trayActivated(QSystemTrayIcon::ActivationReason reason)
 {
-    qDebug() << "HasInhibitChanged?" << has_inhibit;
-    if (has_inhibit) { resetTimer(); }
+    Q_UNUSED(reason)
+    /*switch(reason) {
+    case QSystemTrayIcon::Context:
+    case QSystemTrayIcon::Trigger:
+        //if (menu->actions().size()>0) { menu->popup(QCursor::pos()); }
+    default:;
+    }*/
 }
 
-// handle critical battery
-void SysTray::handleCritical()
+void SysTray::loadSettings()
 {
-    qDebug() << "critical battery level, action?" << criticalAction;
-    switch(criticalAction) {
-    case criticalHibernate:
-        man->hibernate();
-        break;
-    case criticalShutdown:
-        qDebug() << "feature not added!"; // TODO!!!!
-        break;
-    default: ;
-    }
+    config = PowerConfig::load();
+    handleState(current);
 }
 
-// draw battery percent over tray icon
-void SysTray::drawBattery(double left)
+// battery state from the daemon, the tray is only updated
+// when the tooltip, icon or visibility changes
+void SysTray::handleState(const QVariantMap &state)
 {
-    if (!showTray && tray->isVisible()) {
-        tray->hide();
-        return;
-    }
-    if (tray->isSystemTrayAvailable() && !tray->isVisible() && showTray) { tray->show(); }
+    if (state.isEmpty()) { return; }
+    current = state;
+    if (!tray) { setupTray(); }
+    if (icons.themeChanged()) { view.iconKey = ICON_CACHE_INVALID_KEY; }
 
-    QIcon icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON)));
-    if (left<=(double)lowBatteryValue && man->onBattery()) {
-        icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_LOW, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_LOW)));
-        if (!wasLowBattery) { tray->showMessage(tr("Low Battery!"), tr("You battery is almost empty, please consider connecting your computer to a power supply.")); }
-        wasLowBattery = true;
+    TrayView next;
+    next.visible = config.showTray && tray->isSystemTrayAvailable();
+    if (next.visible) {
+        next.toolTip = toolTip(state);
+        next.iconKey = iconKey(state.value("percent").toDouble(), state.value("on_battery").toBool(), state.value("band").toInt());
     } else {
-        wasLowBattery = false;
-        if (left<=(double)lowBatteryValue) { // low (on ac)
-            qDebug() << "low on ac";
-            icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_LOW_AC, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_LOW_AC)));
-        } else if (left<=critBatteryValue) { // critical
-            qDebug() << "critical";
-            if (man->onBattery()) {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_CRIT, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_CRIT)));
-            } else {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_CRIT_AC, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_CRIT_AC)));
-            }
-        } else if (left>(double)lowBatteryValue && left<90) { // good
-            qDebug() << "good";
-            if (man->onBattery()) {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_GOOD, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_GOOD)));
-            } else {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_GOOD_AC, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_GOOD_AC)));
-            }
-        } else if (left>=90 && left<99) { // almost full
-            qDebug() << "almost full";
-            if (man->onBattery()) {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_FULL, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_FULL)));
-            } else {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_FULL_AC, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_FULL_AC)));
-            }
-        } else if(left>=99) { // full
-            qDebug() << "full";
-            if (man->onBattery()) {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_FULL, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_FULL)));
-            } else {
-                icon = QIcon::fromTheme(DEFAULT_BATTERY_ICON_CHARGED, QIcon(QString(":/icons/%1.png").arg(DEFAULT_BATTERY_ICON_CHARGED)));
-            }
-        } else {
-            qDebug() << "something else";
-            // TODO
-        }
+        next.toolTip = view.toolTip;
+        next.iconKey = view.iconKey;
     }
-
-    if (left > 99 || left == 0 || !man->onBattery() || !showBatteryPercent) {
-        tray->setIcon(icon);
+    if (next == view && tray->isVisible() == next.visible) {
+        viewSkipped++;
         return;
     }
+    viewUpdates++;
 
-    QPixmap pixmap = icon.pixmap(QSize(24, 24));
-    QPainter painter(&pixmap);
-    painter.setPen(QColor(Qt::black));
-    painter.drawText(pixmap.rect().adjusted(1, 1, 1, 1), Qt::AlignCenter, QString("%1").arg(left));
-    painter.setPen(QColor(Qt::white));
-    painter.drawText(pixmap.rect(), Qt::AlignCenter, QString("%1").arg(left));
-    tray->setIcon(pixmap);
+    if (next.toolTip != view.toolTip) { tray->setToolTip(next.toolTip); }
+    if (next.iconKey != view.iconKey) {
+        tray->setIcon(icons.icon(next.iconKey));
+        if (daemon) { daemon->powerMetrics()->add(PowerMetrics::counterIconRedraws); }
+    }
+    if (next.visible != tray->isVisible()) { tray->setVisible(next.visible); }
+    view = next;
 }
 
-// timeout, check if idle
-// timeouts and xss must be >= user value and service has to be empty before auto sleep
-void SysTray::timeout()
+void SysTray::handleNotify(const QString &title, const QString &message)
 {
-    if (!showTray && tray->isVisible()) { tray->hide(); }
-    if (tray->isSystemTrayAvailable() && !tray->isVisible() && showTray) { tray->show(); }
-
-    qDebug() << "timeout?" << timeouts;
-    qDebug() << "XSS?" << xIdle();
-    qDebug() << "inhibit?" << pm->HasInhibit();
-
-    int autoSleep = 0;
-    if (man->onBattery()) { autoSleep = autoSleepBattery; }
-    else { autoSleep = autoSleepAC; }
+    if (!tray || !tray->isVisible()) { return; }
+    tray->showMessage(title, message);
+}
 
-    bool doSleep = false;
-    if (autoSleep>0 && timeouts>=autoSleep && xIdle()>=autoSleep && !pm->HasInhibit()) { doSleep = true; }
-    if (!doSleep) { timeouts++; }
-    else {
-        timeouts = 0;
-        man->suspend();
+// percent is rounded, it is what the user sees and keeps
+// small changes from touching the tray
+QString SysTray::toolTip(const QVariantMap &state)
+{
+    bool battery = state.value("on_battery").toBool();
+    double batteryLeft = state.value("percent").toDouble();
+    QString result = batteryLeft==100?tr("Charged"):tr("Battery at %1%").arg(qRound(batteryLeft));
+    if (!battery && batteryLeft<100) {
+        qint64 full = state.value("time_to_full").toLongLong();
+        if (full>0) { result.append(tr(" (Charging, %1 until full)").arg(formatTime(full))); }
+        else { result.append(tr(" (Charging)")); }
+    }
+    if (battery) {
+        qint64 empty = state.value("time_to_empty").toLongLong();
+        if (empty>0) { result.append(tr(" (%1 left)").arg(formatTime(empty))); }
     }
+    if (state.contains("batteries")) { result.append(batteryDetails(state.value("batteries"), state.value("rate").toDouble())); }
+    return result;
 }
 
-// get user idle time
-int SysTray::xIdle()
+// per battery lines and total rate for the tooltip,
+// nested values arrive as QDBusArgument from a separate daemon
+QString SysTray::batteryDetails(const QVariant &batteries, double rate)
 {
-    long idle = 0;
-    Display *display = XOpenDisplay(0);
-    if (display != 0) {
-        XScreenSaverInfo *info = XScreenSaverAllocInfo();
-        XScreenSaverQueryInfo(display, DefaultRootWindow(display), info);
-        if (info) {
-            idle = info->idle;
-            XFree(info);
+    QString result;
+    QVariantList list = qdbus_cast<QVariantList>(batteries);
+    if (list.size()>1) {
+        for (int i=0;i<list.size();++i) {
+            QVariantMap state = qdbus_cast<QVariantMap>(list.at(i));
+            if (!state.value("present").toBool()) { continue; }
+            result.append(tr("\n%1: %2%").arg(state.value("name").toString()).arg(qRound(state.value("percent").toDouble())));
+            double power = state.value("rate").toDouble();
+            if (power != 0) { result.append(tr(" (%1 W)").arg(power, 0, 'f', 1)); }
         }
     }
-    XCloseDisplay(display);
-    int hours = idle/(1000*60*60);
-    int minutes = (idle-(hours*1000*60*60))/(1000*60);
-    return minutes;
+    if (rate != 0) { result.append(tr("\nRate: %1 W").arg(rate, 0, 'f', 1)); }
+    return result;
 }
 
-// reset the idle timer
-void SysTray::resetTimer()
+// seconds as 1h 05m
+QString SysTray::formatTime(qint64 seconds)
 {
-    timeouts = 0;
+    qint64 minutes = seconds/60;
+    if (minutes<60) { return tr("%1m").arg(minutes); }
+    return tr("%1h %2m").arg(minutes/60).arg(minutes%60, 2, 10, QChar('0'));
 }
 
-void SysTray::handleDisplay(QString display, bool connected)
-{
-    qDebug() << display << connected;
-    if (monitors[display] == connected) { return; }
-
-    bool wasConnected = monitors[display];
-    monitors[display] = connected;
-    if (wasConnected && !connected) {
-        // Turn off monitor using xrandr when disconnected.
-        // This is needed else we end up with a virtual screen with the apps from that screen.
-        qDebug() << "remove screen" << display;
-        QProcess::startDetached(QString(TURN_OFF_MONITOR).arg(display));
-    } else if (!wasConnected && connected) {
-        // Turn on monitor using xrandr, then launch lumina-xconfig
-        qDebug() << "add screen" << display;
-        QProcess::startDetached(QString(TURN_ON_MONITOR).arg(display));
-        QProcess::startDetached(XCONFIG);
-    }
-}
+// battery icon for the band with percent overlay
+static const IconCache::State bandIcons[PowerPolicy::bandCount] = {
+    IconCache::stateCritical,
+    IconCache::stateLow,
+    IconCache::stateGood,
+    IconCache::stateFull,
+    IconCache::stateCharged
+};
 
-void SysTray::handleFoundDisplays(QMap<QString, bool> displays)
+quint32 SysTray::iconKey(double left, bool battery, int band)
 {
-    qDebug() << displays;
-    monitors = displays;
-}
+    if (band<0 || band>=PowerPolicy::bandCount) { band = PowerPolicy::bandGood; }
+    IconCache::State state = bandIcons[band];
 
-bool SysTray::internalMonitorIsConnected()
-{
-    QMapIterator<QString, bool> i(monitors);
-    while (i.hasNext()) {
-        i.next();
-        if (i.key().startsWith(INTERNAL_MONITOR)) {
-            qDebug() << "internal monitor connected?" << i.key() << i.value();
-            return i.value();
-        }
-    }
-    return false;
-}
+    int percent = -1;
+    if (!(left > 99 || left == 0 || !battery || !config.showBatteryPercent)) { percent = qRound(left); }
 
-bool SysTray::externalMonitorIsConnected()
-{
-    QMapIterator<QString, bool> i(monitors);
-    while (i.hasNext()) {
-        i.next();
-        if (!i.key().startsWith(INTERNAL_MONITOR) && !i.key().startsWith(VIRTUAL_MONITOR)) {
-            qDebug() << "external monitor connected?" << i.key() << i.value();
-            if (i.value()) { return true; }
-        }
-    }
-    return false;
+#if QT_VERSION >= 0x050000
+    qreal dpr = qApp->devicePixelRatio();
+#else
+    qreal dpr = 1;
+#endif
+    return IconCache::key(state, !battery, percent, dpr);
 }
@@ -17,23 +17,39 @@
 #include <QAction>
 #include <QDebug>
 #include <QSettings>
-#include <QPainter>
 #include <QMap>
 #include <QMapIterator>
-#include <QProcess>
+#include <QDBusServiceWatcher>
 
 #include "common.h"
-#include "power.h"
-#include "powermanagement.h"
-#include "screensaver.h"
+#include "iconcache.h"
+#include "configwatcher.h"
+#include "powerdaemon.h"
 
-#include <X11/extensions/scrnsaver.h>
-#include "hotplug.h"
-// fix X11 inc
-#undef CursorShape
-//#undef Bool // done in hotplug.h
-#undef Status
+// msec to wait for lumina-power-daemon to come back before running it here
+#define TRAY_DAEMON_RESTART_WAIT 2000
 
+// what the tray shows, it is only touched when this changes
+struct TrayView
+{
+    QString toolTip;
+    quint32 iconKey;
+    bool visible;
+
+    TrayView()
+        : iconKey(ICON_CACHE_INVALID_KEY)
+        , visible(false)
+    {
+    }
+    bool operator==(const TrayView &other) const
+    {
+        return toolTip == other.toolTip && iconKey == other.iconKey && visible == other.visible;
+    }
+};
+
+// tray client, shows the state published by the power daemon.
+// runs the daemon in process if lumina-power-daemon is not running,
+// or when it exits.
 class SysTray : public QObject
 {
     Q_OBJECT
@@ -44,49 +60,31 @@ public:
 
 private:
     QSystemTrayIcon *tray;
-    Power *man;
-    PowerManagement *pm;
-    ScreenSaver *ss;
-    HotPlug *ht;
-    bool wasLowBattery;
-    int lowBatteryValue;
-    int critBatteryValue;
-    bool hasService;
-    int lidActionBattery;
-    int lidActionAC;
-    int criticalAction;
-    int autoSleepBattery;
-    int autoSleepAC;
-    QTimer *timer;
-    int timeouts;
-    bool showNotifications;
-    bool desktopSS;
-    bool desktopPM;
-    bool showBatteryPercent;
-    bool showTray;
-    QMap<QString, bool> monitors;
-    bool disableLidACOnExternalMonitors;
-    bool disableLidBatteryOnExternalMonitors;
+    PowerDaemon *daemon;
+    ConfigWatcher *watcher;
+    QDBusServiceWatcher *serviceWatcher;
+    PowerConfig config;
+    QVariantMap current;
+    IconCache icons;
+    TrayView view;
+    int viewUpdates;
+    int viewSkipped;
+    void connectDaemon();
+    void disconnectDaemon();
 
 private slots:
+    void setupTray();
     void trayActivated(QSystemTrayIcon::ActivationReason reason);
-    void checkDevices();
-    void handleClosedLid();
-    void handleOpenedLid();
-    void handleOnBattery();
-    void handleOnAC();
     void loadSettings();
-    void registerService();
-    void handleHasInhibitChanged(bool has_inhibit);
-    void handleCritical();
-    void drawBattery(double left);
-    void timeout();
-    int xIdle();
-    void resetTimer();
-    void handleDisplay(QString display, bool connected);
-    void handleFoundDisplays(QMap<QString,bool> displays);
-    bool internalMonitorIsConnected();
-    bool externalMonitorIsConnected();
+    void startDaemon();
+    void handleServiceRegistered(const QString &name);
+    void handleServiceUnregistered(const QString &name);
+    void handleState(const QVariantMap &state);
+    void handleNotify(const QString &title, const QString &message);
+    QString formatTime(qint64 seconds);
+    QString batteryDetails(const QVariant &batteries, double rate);
+    QString toolTip(const QVariantMap &state);
+    quint32 iconKey(double left, bool battery, int band);
 };
 
 #endif // SYSTRAY_H
@@ -0,0 +1,167 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "topology.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
+
+Topology::Topology()
+    : timestamp(0)
+    , configTimestamp(0)
+{
+}
+
+QMap<QString, bool> Topology::connections() const
+{
+    QMap<QString, bool> result;
+    QMapIterator<QString, TopologyOutput> i(outputs);
+    while (i.hasNext()) {
+        i.next();
+        result[i.key()] = i.value().connected;
+    }
+    return result;
+}
+
+// outputs that changed connection state since previous,
+// outputs that went away are reported as disconnected
+QMap<QString, bool> Topology::connectionChanges(const Topology &previous) const
+{
+    QMap<QString, bool> result;
+    QMapIterator<QString, TopologyOutput> i(outputs);
+    while (i.hasNext()) {
+        i.next();
+        if (previous.outputs.value(i.key()).connected != i.value().connected) {
+            result[i.key()] = i.value().connected;
+        }
+    }
+    QMapIterator<QString, TopologyOutput> j(previous.outputs);
+    while (j.hasNext()) {
+        j.next();
+        if (j.value().connected && !outputs.contains(j.key())) { result[j.key()] = false; }
+    }
+    return result;
+}
+
+bool Topology::operator==(const Topology &other) const
+{
+    return outputs == other.outputs;
+}
+
+// laptop panel by connector type, drivers name them LVDS, eDP or DSI
+bool Topology::isInternal(const QString &name)
+{
+    static const char *panels[] = { "LVDS", "eDP", "DSI", NULL };
+    for (int i=0;panels[i];++i) {
+        if (name.startsWith(panels[i])) { return true; }
+    }
+    return false;
+}
+
+TopologyCache::TopologyCache(XConnection *connection)
+    : xcon(connection)
+    , timestamp(0)
+    , configTimestamp(0)
+    , edidAtom(0)
+{
+}
+
+Topology TopologyCache::snapshot()
+{
+    Topology result;
+    if (!xcon->isValid() || xcon->randrEventBase()<0) { return result; }
+    Display *dpy = xcon->display();
+    XRoundTrip trip(xcon);
+
+    XRRScreenResources *sr = XRRGetScreenResourcesCurrent(dpy, xcon->rootWindow());
+    if (sr == NULL) { return result; }
+    if (sr->timestamp != timestamp || sr->configTimestamp != configTimestamp) {
+        cache.clear();
+        timestamp = sr->timestamp;
+        configTimestamp = sr->configTimestamp;
+    }
+    result.timestamp = timestamp;
+    result.configTimestamp = configTimestamp;
+
+    // crtcs shared by cloned outputs are only fetched once
+    QHash<unsigned long, TopologyOutput> crtcs;
+    for (int i=0;i<sr->noutput;++i) {
+        RROutput id = sr->outputs[i];
+        QHash<unsigned long, TopologyOutput>::const_iterator cached = cache.constFind(id);
+        if (cached != cache.constEnd()) {
+            result.outputs.insert(cached.value().name, cached.value());
+            continue;
+        }
+
+        XRROutputInfo *info = XRRGetOutputInfo(dpy, sr, id);
+        if (info == NULL) { continue; }
+        TopologyOutput output;
+        output.id = id;
+        output.name = QString::fromLocal8Bit(info->name, info->nameLen);
+        output.connected = info->connection == RR_Connected;
+        output.crtc = info->crtc;
+        XRRFreeOutputInfo(info);
+
+        if (output.crtc) {
+            if (!crtcs.contains(output.crtc)) {
+                TopologyOutput crtc;
+                XRRCrtcInfo *crtcInfo = XRRGetCrtcInfo(dpy, sr, output.crtc);
+                if (crtcInfo) {
+                    crtc.mode = crtcInfo->mode;
+                    crtc.rotation = crtcInfo->rotation;
+                    crtc.geometry = QRect(crtcInfo->x, crtcInfo->y, crtcInfo->width, crtcInfo->height);
+                    XRRFreeCrtcInfo(crtcInfo);
+                }
+                crtcs.insert(output.crtc, crtc);
+            }
+            const TopologyOutput &crtc = crtcs[output.crtc];
+            output.mode = crtc.mode;
+            output.rotation = crtc.rotation;
+            output.geometry = crtc.geometry;
+        }
+        if (output.connected) { output.edid = readEdid(id); }
+
+        cache.insert(id, output);
+        result.outputs.insert(output.name, output);
+    }
+    XRRFreeScreenResources(sr);
+    return result;
+}
+
+// output changed, fetch it again on next snapshot
+void TopologyCache::invalidate(unsigned long output)
+{
+    cache.remove(output);
+}
+
+void TopologyCache::clear()
+{
+    cache.clear();
+}
+
+QByteArray TopologyCache::readEdid(unsigned long output)
+{
+    QByteArray result;
+    Display *dpy = xcon->display();
+    if (!edidAtom) { edidAtom = XInternAtom(dpy, RR_PROPERTY_RANDR_EDID, False); }
+
+    Atom actualType;
+    int actualFormat;
+    unsigned long nitems, bytesAfter;
+    unsigned char *prop = NULL;
+    if (XRRGetOutputProperty(dpy, output, edidAtom, 0, 128, False, False, AnyPropertyType,
+                             &actualType, &actualFormat, &nitems, &bytesAfter, &prop) == Success) {
+        if (prop && actualType == XA_INTEGER && actualFormat == 8) {
+            result = QByteArray((const char*)prop, (int)nitems);
+        }
+        if (prop) { XFree(prop); }
+    }
+    return result;
+}
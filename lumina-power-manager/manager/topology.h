@@ -0,0 +1,87 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <QString>
+#include <QByteArray>
+#include <QRect>
+#include <QMap>
+#include <QHash>
+
+#include "xconnection.h"
+
+// RandR output state, crtc/mode is 0 when the output is off
+struct TopologyOutput
+{
+    unsigned long id;
+    QString name;
+    bool connected;
+    unsigned long crtc;
+    unsigned long mode;
+    int rotation;
+    QRect geometry;
+    QByteArray edid;
+
+    TopologyOutput()
+        : id(0)
+        , connected(false)
+        , crtc(0)
+        , mode(0)
+        , rotation(0)
+    {
+    }
+    bool operator==(const TopologyOutput &other) const
+    {
+        return id == other.id && name == other.name && connected == other.connected &&
+               crtc == other.crtc && mode == other.mode && rotation == other.rotation &&
+               geometry == other.geometry && edid == other.edid;
+    }
+    bool operator!=(const TopologyOutput &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// snapshot of all RandR outputs, keyed by output name
+class Topology
+{
+public:
+    Topology();
+    unsigned long timestamp;
+    unsigned long configTimestamp;
+    QMap<QString, TopologyOutput> outputs;
+    QMap<QString, bool> connections() const;
+    QMap<QString, bool> connectionChanges(const Topology &previous) const;
+    bool operator==(const Topology &other) const;
+    static bool isInternal(const QString &name);
+};
+
+// builds topology snapshots in one pass over the screen resources,
+// output info is cached by output id until the RandR timestamps change
+// or the output is invalidated by an event.
+class TopologyCache
+{
+public:
+    explicit TopologyCache(XConnection *connection);
+    Topology snapshot();
+    void invalidate(unsigned long output);
+    void clear();
+
+private:
+    XConnection *xcon;
+    unsigned long timestamp;
+    unsigned long configTimestamp;
+    unsigned long edidAtom;
+    QHash<unsigned long, TopologyOutput> cache;
+    QByteArray readEdid(unsigned long output);
+};
+
+#endif // TOPOLOGY_H
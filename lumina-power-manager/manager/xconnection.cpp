@@ -0,0 +1,178 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "xconnection.h"
+
+#include <QSocketNotifier>
+#include <QAbstractEventDispatcher>
+#include <QDebug>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
+#include <X11/extensions/sync.h>
+#include <X11/extensions/scrnsaver.h>
+
+XConnection::XConnection(QObject *parent) :
+    QObject(parent)
+  , dpy(0)
+  , notifier(0)
+  , randrBase(-1)
+  , syncBase(-1)
+  , screenSaverBase(-1)
+  , trips(0)
+  , tripTime(0)
+  , maxTripTime(0)
+  , wakeupCount(0)
+{
+    if ((dpy = XOpenDisplay(NULL)) == NULL) {
+        qWarning("Cannot open X display.");
+        return;
+    }
+
+    int eventBase, errorBase, major, minor;
+    if (XRRQueryExtension(dpy, &eventBase, &errorBase)) { randrBase = eventBase; }
+    if (XSyncQueryExtension(dpy, &eventBase, &errorBase) &&
+        XSyncInitialize(dpy, &major, &minor)) { syncBase = eventBase; }
+    if (XScreenSaverQueryExtension(dpy, &eventBase, &errorBase)) { screenSaverBase = eventBase; }
+
+    notifier = new QSocketNotifier(ConnectionNumber(dpy), QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+
+    // replies read during a round trip may queue events without
+    // waking the socket notifier, check before the event loop blocks
+    connect(QAbstractEventDispatcher::instance(), SIGNAL(aboutToBlock()), this, SLOT(readQueuedEvents()));
+}
+
+XConnection::~XConnection()
+{
+    if (dpy == NULL) { return; }
+    disconnect(QAbstractEventDispatcher::instance(), SIGNAL(aboutToBlock()), this, SLOT(readQueuedEvents()));
+    notifier->setEnabled(false);
+    XCloseDisplay(dpy);
+    dpy = NULL;
+}
+
+bool XConnection::isValid()
+{
+    return dpy != NULL;
+}
+
+Display *XConnection::display()
+{
+    return dpy;
+}
+
+unsigned long XConnection::rootWindow()
+{
+    if (dpy == NULL) { return 0; }
+    return DefaultRootWindow(dpy);
+}
+
+int XConnection::randrEventBase()
+{
+    return randrBase;
+}
+
+int XConnection::syncEventBase()
+{
+    return syncBase;
+}
+
+int XConnection::screenSaverEventBase()
+{
+    return screenSaverBase;
+}
+
+// number of measured round trips
+int XConnection::roundTrips()
+{
+    return trips;
+}
+
+// total round trip time in usec
+qint64 XConnection::roundTripTime()
+{
+    return tripTime;
+}
+
+qint64 XConnection::maxRoundTripTime()
+{
+    return maxTripTime;
+}
+
+void XConnection::addRoundTrip(qint64 usec)
+{
+    trips++;
+    tripTime += usec;
+    if (usec>maxTripTime) { maxTripTime = usec; }
+    tripHistogram.add(usec);
+}
+
+const LatencyHistogram &XConnection::roundTripHistogram()
+{
+    return tripHistogram;
+}
+
+// event reads, from the socket or already queued
+int XConnection::wakeups()
+{
+    return wakeupCount;
+}
+
+// send pending requests
+void XConnection::flush()
+{
+    if (dpy == NULL) { return; }
+    XFlush(dpy);
+}
+
+void XConnection::sync()
+{
+    if (dpy == NULL) { return; }
+    XRoundTrip trip(this);
+    XSync(dpy, False);
+}
+
+// drain all events per wakeup
+void XConnection::readEvents()
+{
+    if (dpy == NULL) { return; }
+    wakeupCount++;
+    while (XPending(dpy)) {
+        XEvent ev;
+        XNextEvent(dpy, &ev);
+        int type = ev.type & 0x7f;
+        if (randrBase>=0 && (type == randrBase+RRScreenChangeNotify || type == randrBase+RRNotify)) {
+            XRRUpdateConfiguration(&ev);
+            emit randrEvent(&ev);
+        } else if (syncBase>=0 && (type == syncBase+XSyncCounterNotify || type == syncBase+XSyncAlarmNotify)) {
+            emit syncEvent(&ev);
+        } else if (screenSaverBase>=0 && type == screenSaverBase+ScreenSaverNotify) {
+            emit screenSaverEvent(&ev);
+        }
+    }
+}
+
+// events already read from the socket, does not touch the socket
+void XConnection::readQueuedEvents()
+{
+    if (dpy == NULL) { return; }
+    if (XEventsQueued(dpy, QueuedAlready) > 0) { readEvents(); }
+}
+
+XRoundTrip::XRoundTrip(XConnection *connection) :
+    xcon(connection)
+{
+    timer.start();
+}
+
+XRoundTrip::~XRoundTrip()
+{
+    if (xcon) { xcon->addRoundTrip(timer.nsecsElapsed()/1000); }
+}
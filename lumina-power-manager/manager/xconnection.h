@@ -0,0 +1,83 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef XCONNECTION_H
+#define XCONNECTION_H
+
+#include <QObject>
+#include <QElapsedTimer>
+
+#include "latencytrace.h"
+
+class QSocketNotifier;
+typedef struct _XDisplay Display;
+typedef union _XEvent XEvent;
+
+// shared X connection, owned by the power manager.
+// events are read from the Qt event loop and routed to subscribers
+// by extension, consumers must not open their own display.
+class XConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit XConnection(QObject *parent = NULL);
+    ~XConnection();
+    bool isValid();
+    Display *display();
+    unsigned long rootWindow();
+    int randrEventBase();
+    int syncEventBase();
+    int screenSaverEventBase();
+    int roundTrips();
+    qint64 roundTripTime();
+    qint64 maxRoundTripTime();
+    void addRoundTrip(qint64 usec);
+    const LatencyHistogram &roundTripHistogram();
+    int wakeups();
+
+private:
+    Display *dpy;
+    QSocketNotifier *notifier;
+    int randrBase;
+    int syncBase;
+    int screenSaverBase;
+    int trips;
+    qint64 tripTime;
+    qint64 maxTripTime;
+    LatencyHistogram tripHistogram;
+    int wakeupCount;
+
+signals:
+    void randrEvent(XEvent *ev);
+    void syncEvent(XEvent *ev);
+    void screenSaverEvent(XEvent *ev);
+
+public slots:
+    void flush();
+    void sync();
+
+private slots:
+    void readEvents();
+    void readQueuedEvents();
+};
+
+// measure a blocking request on the shared connection
+class XRoundTrip
+{
+public:
+    explicit XRoundTrip(XConnection *connection);
+    ~XRoundTrip();
+
+private:
+    XConnection *xcon;
+    QElapsedTimer timer;
+};
+
+#endif // XCONNECTION_H
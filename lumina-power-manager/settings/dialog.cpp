@@ -14,7 +14,7 @@
 #include <QTabWidget>
 #include "common.h"
 #include <QDBusConnection>
-#include <QDBusInterface>
+#include <QDBusMessage>
 #include <QMessageBox>
 
 Dialog::Dialog(QWidget *parent)
@@ -24,15 +24,26 @@ Dialog::Dialog(QWidget *parent)
     , criticalActionBattery(0)
     , lowBattery(0)
     , criticalBattery(0)
+    , criticalPredict(0)
     , autoSleepBattery(0)
     , autoSleepAC(0)
+    , screenOffBattery(0)
+    , screenOffAC(0)
+    , lockBattery(0)
+    , lockAC(0)
+    , dimBattery(0)
+    , dimAC(0)
+    , brightnessBattery(0)
+    , brightnessAC(0)
     , desktopSS(0)
     , desktopPM(0)
     , showNotifications(0)
     , showBatteryPercent(0)
+    , sysfsBackend(0)
     , showSystemTray(0)
     , disableLidActionAC(0)
     , disableLidActionBattery(0)
+    , applyTimer(0)
 {
     // setup dialog
     setAttribute(Qt::WA_QuitOnClose, true);
@@ -111,6 +122,10 @@ Dialog::Dialog(QWidget *parent)
     criticalBatteryContainerLayout->addWidget(criticalBattery);
     batteryContainerLayout->addWidget(criticalBatteryContainer);
 
+    criticalPredict = new QCheckBox(this);
+    criticalPredict->setText(tr("Critical action before battery runs out"));
+    batteryContainerLayout->addWidget(criticalPredict);
+
     QWidget *sleepBatteryContainer = new QWidget(this);
     QHBoxLayout *sleepBatteryContainerLayout = new QHBoxLayout(sleepBatteryContainer);
     autoSleepBattery = new QSpinBox(this);
@@ -123,6 +138,54 @@ Dialog::Dialog(QWidget *parent)
     sleepBatteryContainerLayout->addWidget(autoSleepBattery);
     batteryContainerLayout->addWidget(sleepBatteryContainer);
 
+    QWidget *screenOffBatteryContainer = new QWidget(this);
+    QHBoxLayout *screenOffBatteryContainerLayout = new QHBoxLayout(screenOffBatteryContainer);
+    screenOffBattery = new QSpinBox(this);
+    screenOffBattery->setMinimum(0);
+    screenOffBattery->setMaximum(36000);
+    QLabel *screenOffBatteryLabel = new QLabel(this);
+
+    screenOffBatteryLabel->setText(tr("Turn off screen (sec)"));
+    screenOffBatteryContainerLayout->addWidget(screenOffBatteryLabel);
+    screenOffBatteryContainerLayout->addWidget(screenOffBattery);
+    batteryContainerLayout->addWidget(screenOffBatteryContainer);
+
+    QWidget *lockBatteryContainer = new QWidget(this);
+    QHBoxLayout *lockBatteryContainerLayout = new QHBoxLayout(lockBatteryContainer);
+    lockBattery = new QSpinBox(this);
+    lockBattery->setMinimum(0);
+    lockBattery->setMaximum(36000);
+    QLabel *lockBatteryLabel = new QLabel(this);
+
+    lockBatteryLabel->setText(tr("Lock screen (sec)"));
+    lockBatteryContainerLayout->addWidget(lockBatteryLabel);
+    lockBatteryContainerLayout->addWidget(lockBattery);
+    batteryContainerLayout->addWidget(lockBatteryContainer);
+
+    QWidget *dimBatteryContainer = new QWidget(this);
+    QHBoxLayout *dimBatteryContainerLayout = new QHBoxLayout(dimBatteryContainer);
+    dimBattery = new QSpinBox(this);
+    dimBattery->setMinimum(0);
+    dimBattery->setMaximum(36000);
+    QLabel *dimBatteryLabel = new QLabel(this);
+
+    dimBatteryLabel->setText(tr("Dim screen (sec)"));
+    dimBatteryContainerLayout->addWidget(dimBatteryLabel);
+    dimBatteryContainerLayout->addWidget(dimBattery);
+    batteryContainerLayout->addWidget(dimBatteryContainer);
+
+    QWidget *brightnessBatteryContainer = new QWidget(this);
+    QHBoxLayout *brightnessBatteryContainerLayout = new QHBoxLayout(brightnessBatteryContainer);
+    brightnessBattery = new QSpinBox(this);
+    brightnessBattery->setMinimum(0);
+    brightnessBattery->setMaximum(100);
+    QLabel *brightnessBatteryLabel = new QLabel(this);
+
+    brightnessBatteryLabel->setText(tr("Brightness (%)"));
+    brightnessBatteryContainerLayout->addWidget(brightnessBatteryLabel);
+    brightnessBatteryContainerLayout->addWidget(brightnessBattery);
+    batteryContainerLayout->addWidget(brightnessBatteryContainer);
+
     batteryContainerLayout->addStretch();
     containerWidget->addTab(batteryContainer, tr("On Battery"));
 
@@ -157,6 +220,54 @@ Dialog::Dialog(QWidget *parent)
     sleepACContainerLayout->addWidget(autoSleepAC);
     acContainerLayout->addWidget(sleepACContainer);
 
+    QWidget *screenOffACContainer = new QWidget(this);
+    QHBoxLayout *screenOffACContainerLayout = new QHBoxLayout(screenOffACContainer);
+    screenOffAC = new QSpinBox(this);
+    screenOffAC->setMinimum(0);
+    screenOffAC->setMaximum(36000);
+    QLabel *screenOffACLabel = new QLabel(this);
+
+    screenOffACLabel->setText(tr("Turn off screen (sec)"));
+    screenOffACContainerLayout->addWidget(screenOffACLabel);
+    screenOffACContainerLayout->addWidget(screenOffAC);
+    acContainerLayout->addWidget(screenOffACContainer);
+
+    QWidget *lockACContainer = new QWidget(this);
+    QHBoxLayout *lockACContainerLayout = new QHBoxLayout(lockACContainer);
+    lockAC = new QSpinBox(this);
+    lockAC->setMinimum(0);
+    lockAC->setMaximum(36000);
+    QLabel *lockACLabel = new QLabel(this);
+
+    lockACLabel->setText(tr("Lock screen (sec)"));
+    lockACContainerLayout->addWidget(lockACLabel);
+    lockACContainerLayout->addWidget(lockAC);
+    acContainerLayout->addWidget(lockACContainer);
+
+    QWidget *dimACContainer = new QWidget(this);
+    QHBoxLayout *dimACContainerLayout = new QHBoxLayout(dimACContainer);
+    dimAC = new QSpinBox(this);
+    dimAC->setMinimum(0);
+    dimAC->setMaximum(36000);
+    QLabel *dimACLabel = new QLabel(this);
+
+    dimACLabel->setText(tr("Dim screen (sec)"));
+    dimACContainerLayout->addWidget(dimACLabel);
+    dimACContainerLayout->addWidget(dimAC);
+    acContainerLayout->addWidget(dimACContainer);
+
+    QWidget *brightnessACContainer = new QWidget(this);
+    QHBoxLayout *brightnessACContainerLayout = new QHBoxLayout(brightnessACContainer);
+    brightnessAC = new QSpinBox(this);
+    brightnessAC->setMinimum(0);
+    brightnessAC->setMaximum(100);
+    QLabel *brightnessACLabel = new QLabel(this);
+
+    brightnessACLabel->setText(tr("Brightness (%)"));
+    brightnessACContainerLayout->addWidget(brightnessACLabel);
+    brightnessACContainerLayout->addWidget(brightnessAC);
+    acContainerLayout->addWidget(brightnessACContainer);
+
     acContainerLayout->addStretch();
     containerWidget->addTab(acContainer, tr("On AC"));
 
@@ -189,23 +300,43 @@ Dialog::Dialog(QWidget *parent)
     showBatteryPercent->setText(tr("Battery percent"));
     extraContainerLayout->addWidget(showBatteryPercent);
 
+    sysfsBackend = new QCheckBox(this);
+    sysfsBackend->setText(tr("Read battery from sysfs"));
+    extraContainerLayout->addWidget(sysfsBackend);
+
     layout->addWidget(extraContainer);
 
     populate(); // populate boxes
     loadSettings(); // load settings
 
+    // changes are collected and applied in one go
+    applyTimer = new QTimer(this);
+    applyTimer->setSingleShot(true);
+    applyTimer->setInterval(300);
+    connect(applyTimer, SIGNAL(timeout()), this, SLOT(applySettings()));
+
     // connect varius widgets
     connect(lidActionBattery, SIGNAL(currentIndexChanged(int)), this, SLOT(handleLidActionBattery(int)));
     connect(lidActionAC, SIGNAL(currentIndexChanged(int)), this, SLOT(handleLidActionAC(int)));
     connect(criticalActionBattery, SIGNAL(currentIndexChanged(int)), this, SLOT(handleCriticalAction(int)));
     connect(lowBattery, SIGNAL(valueChanged(int)), this, SLOT(handleLowBattery(int)));
     connect(criticalBattery, SIGNAL(valueChanged(int)), this, SLOT(handleCriticalBattery(int)));
+    connect(criticalPredict, SIGNAL(toggled(bool)), this, SLOT(handleCriticalPredict(bool)));
     connect(autoSleepBattery, SIGNAL(valueChanged(int)), this, SLOT(handleAutoSleepBattery(int)));
     connect(autoSleepAC, SIGNAL(valueChanged(int)), this, SLOT(handleAutoSleepAC(int)));
+    connect(screenOffBattery, SIGNAL(valueChanged(int)), this, SLOT(handleScreenOffBattery(int)));
+    connect(screenOffAC, SIGNAL(valueChanged(int)), this, SLOT(handleScreenOffAC(int)));
+    connect(lockBattery, SIGNAL(valueChanged(int)), this, SLOT(handleLockBattery(int)));
+    connect(lockAC, SIGNAL(valueChanged(int)), this, SLOT(handleLockAC(int)));
+    connect(dimBattery, SIGNAL(valueChanged(int)), this, SLOT(handleDimBattery(int)));
+    connect(dimAC, SIGNAL(valueChanged(int)), this, SLOT(handleDimAC(int)));
+    connect(brightnessBattery, SIGNAL(valueChanged(int)), this, SLOT(handleBrightnessBattery(int)));
+    connect(brightnessAC, SIGNAL(valueChanged(int)), this, SLOT(handleBrightnessAC(int)));
     connect(desktopSS, SIGNAL(toggled(bool)), this, SLOT(handleDesktopSS(bool)));
     connect(desktopPM, SIGNAL(toggled(bool)), this, SLOT(handleDesktopPM(bool)));
     connect(showNotifications, SIGNAL(toggled(bool)), this, SLOT(handleShowNotifications(bool)));
     connect(showBatteryPercent, SIGNAL(toggled(bool)), this, SLOT(handleShowBatteryPercent(bool)));
+    connect(sysfsBackend, SIGNAL(toggled(bool)), this, SLOT(handleSysfsBackend(bool)));
     connect(showSystemTray, SIGNAL(toggled(bool)), this, SLOT(handleShowSystemTray(bool)));
     connect(disableLidActionAC, SIGNAL(toggled(bool)), this, SLOT(handleDisableLidActionAC(bool)));
     connect(disableLidActionBattery, SIGNAL(toggled(bool)), this, SLOT(handleDisableLidActionBattery(bool)));
@@ -235,97 +366,75 @@ void Dialog::populate()
 // load settings and set as default in widgets
 void Dialog::loadSettings()
 {
-    int defaultAutoSleepBattery = AUTO_SLEEP_BATTERY;
-    if (Common::validPowerSettings("autoSleepBattery")) {
-        defaultAutoSleepBattery = Common::loadPowerSettings("autoSleepBattery").toInt();
-    }
-    setDefaultAction(autoSleepBattery, defaultAutoSleepBattery);
-
-    int defaultAutoSleepAC = 0; // don't add default on AC, not all (normal) machines support suspend.
-    if (Common::validPowerSettings("autoSleepAC")) {
-        defaultAutoSleepAC = Common::loadPowerSettings("autoSleepAC").toInt();
-    }
-    setDefaultAction(autoSleepAC, defaultAutoSleepAC);
-
-    int defaultLowBattery = LOW_BATTERY;
-    if (Common::validPowerSettings("lowBattery")) {
-        defaultLowBattery = Common::loadPowerSettings("lowBattery").toInt();
-    }
-    setDefaultAction(lowBattery, defaultLowBattery);
-
-    int defaultCriticalBattery = CRITICAL_BATTERY;
-    if (Common::validPowerSettings("criticalBattery")) {
-        defaultCriticalBattery = Common::loadPowerSettings("criticalBattery").toInt();
-    }
-    setDefaultAction(criticalBattery, defaultCriticalBattery);
-
-    int defaultLidActionBattery = LID_BATTERY_DEFAULT;
-    if (Common::validPowerSettings("lidBattery")) {
-        defaultLidActionBattery = Common::loadPowerSettings("lidBattery").toInt();
-    }
-    setDefaultAction(lidActionBattery, defaultLidActionBattery);
-
-    int defaultLidActionAC = LID_AC_DEFAULT;
-    if (Common::validPowerSettings("lidAC")) {
-        defaultLidActionAC = Common::loadPowerSettings("lidAC").toInt();
-    }
-    setDefaultAction(lidActionAC, defaultLidActionAC);
-
-    int defaultCriticalAction = CRITICAL_DEFAULT;
-    if (Common::validPowerSettings("criticalAction")) {
-        defaultCriticalAction = Common::loadPowerSettings("criticalAction").toInt();
-    }
-    setDefaultAction(criticalActionBattery, defaultCriticalAction);
-
-    bool defaultDesktopSS = true;
-    if (Common::validPowerSettings("desktop_ss")) {
-        defaultDesktopSS = Common::loadPowerSettings("desktop_ss").toBool();
-    }
-    desktopSS->setChecked(defaultDesktopSS);
-
-    bool defaultDesktopPM = true;
-    if (Common::validPowerSettings("desktop_pm")) {
-        defaultDesktopPM = Common::loadPowerSettings("desktop_pm").toBool();
-    }
-    desktopPM->setChecked(defaultDesktopPM);
-
-    bool defaultShowNotifications = true;
-    if (Common::validPowerSettings("tray_notify")) {
-        defaultShowNotifications = Common::loadPowerSettings("tray_notify").toBool();
-    }
-    showNotifications->setChecked(defaultShowNotifications);
+    PowerConfig config = PowerConfig::load();
+    setDefaultAction(autoSleepBattery, config.autoSleepBattery);
+    setDefaultAction(autoSleepAC, config.autoSleepAC);
+    setDefaultAction(screenOffBattery, config.screenOffBattery);
+    setDefaultAction(screenOffAC, config.screenOffAC);
+    setDefaultAction(lockBattery, config.lockBattery);
+    setDefaultAction(lockAC, config.lockAC);
+    setDefaultAction(dimBattery, config.dimBattery);
+    setDefaultAction(dimAC, config.dimAC);
+    setDefaultAction(brightnessBattery, config.brightnessBattery);
+    setDefaultAction(brightnessAC, config.brightnessAC);
+    setDefaultAction(lowBattery, config.lowBattery);
+    setDefaultAction(criticalBattery, config.criticalBattery);
+    criticalPredict->setChecked(config.criticalPredict);
+    setDefaultAction(lidActionBattery, config.lidBattery);
+    setDefaultAction(lidActionAC, config.lidAC);
+    setDefaultAction(criticalActionBattery, config.criticalAction);
+    desktopSS->setChecked(config.desktopSS);
+    desktopPM->setChecked(config.desktopPM);
+    showNotifications->setChecked(config.trayNotify);
+    showBatteryPercent->setChecked(config.showBatteryPercent);
+    sysfsBackend->setChecked(config.sysfsBackend);
+    showSystemTray->setChecked(config.showTray);
+    disableLidActionBattery->setChecked(config.disableLidBatteryExternalMonitor);
+    disableLidActionAC->setChecked(config.disableLidACExternalMonitor);
+}
 
-    bool defaultShowBatteryPercent = true;
-    if (Common::validPowerSettings("show_battery_percent")) {
-        defaultShowBatteryPercent = Common::loadPowerSettings("show_battery_percent").toBool();
-    }
-    showBatteryPercent->setChecked(defaultShowBatteryPercent);
+// apply pending changes before closing
+void Dialog::done(int r)
+{
+    applySettings();
+    QDialog::done(r);
+}
 
-    bool defaultShowTray = true;
-    if (Common::validPowerSettings("show_tray")) {
-        defaultShowTray = Common::loadPowerSettings("show_tray").toBool();
-    }
-    showSystemTray->setChecked(defaultShowTray);
+// queue a changed setting, restarts the apply timer
+void Dialog::queueSetting(const QString &key, const QVariant &value)
+{
+    pending[key] = value;
+    applyTimer->start();
+}
 
-    bool defaultDisableLidActionBattery = true;
-    if (Common::validPowerSettings("disable_lid_action_battery_external_monitor")) {
-        defaultDisableLidActionBattery = Common::loadPowerSettings("disable_lid_action_battery_external_monitor").toBool();
-    }
-    disableLidActionBattery->setChecked(defaultDisableLidActionBattery);
+// save pending settings and tell power manager what changed
+void Dialog::applySettings()
+{
+    applyTimer->stop();
+    if (pending.isEmpty()) { return; }
+    PowerConfig::save(pending);
+
+    QDBusMessage message = QDBusMessage::createMethodCall(LPM_SERVICE, LPM_PATH, LPM_INTERFACE, "ApplySettings");
+    message << pending;
+    pending.clear();
+    QDBusConnection::sessionBus().callWithCallback(message, this, SLOT(handleApplyReply(bool)), SLOT(handleApplyError(QDBusError)));
+}
 
-    bool defaultDisableLidActionAC = true;
-    if (Common::validPowerSettings("disable_lid_action_ac_external_monitor")) {
-        defaultDisableLidActionAC = Common::loadPowerSettings("disable_lid_action_ac_external_monitor").toBool();
+// saved, but the power manager did not know all of the settings
+void Dialog::handleApplyReply(bool applied)
+{
+    if (applied) { return; }
+    qWarning() << "power manager did not apply all settings";
+    if (isVisible()) {
+        QMessageBox::warning(this, tr("Settings not applied"), tr("The power manager did not apply all settings, restart it to use them."));
     }
-    disableLidActionAC->setChecked(defaultDisableLidActionAC);
 }
 
-// tell power manager to update settings
-void Dialog::updatePM()
+// power manager without org.lumina.PowerManager, fallback to refresh
+void Dialog::handleApplyError(const QDBusError &error)
 {
-    QDBusInterface iface(PM_SERVICE, PM_PATH, PM_SERVICE, QDBusConnection::sessionBus());
-    if (!iface.isValid()) { return; }
-    iface.call("refresh");
+    qDebug() << "ApplySettings failed" << error.message();
+    QDBusConnection::sessionBus().send(QDBusMessage::createMethodCall(PM_SERVICE, PM_PATH, PM_SERVICE, "refresh"));
 }
 
 // set default action in combobox
@@ -348,86 +457,122 @@ void Dialog::setDefaultAction(QSpinBox *box, int action)
 // save current value and update power manager
 void Dialog::handleLidActionBattery(int index)
 {
-    Common::savePowerSettings("lidBattery", index);
-    updatePM();
+    queueSetting("lidBattery", index);
 }
 
 void Dialog::handleLidActionAC(int index)
 {
-    Common::savePowerSettings("lidAC", index);
-    updatePM();
+    queueSetting("lidAC", index);
 }
 
 void Dialog::handleCriticalAction(int index)
 {
-    Common::savePowerSettings("criticalAction", index);
-    updatePM();
+    queueSetting("criticalAction", index);
 }
 
 void Dialog::handleLowBattery(int value)
 {
-    Common::savePowerSettings("lowBattery", value);
-    updatePM();
+    queueSetting("lowBattery", value);
 }
 
 void Dialog::handleCriticalBattery(int value)
 {
-    Common::savePowerSettings("criticalBattery", value);
-    updatePM();
+    queueSetting("criticalBattery", value);
+}
+
+void Dialog::handleCriticalPredict(bool triggered)
+{
+    queueSetting("critical_predict", triggered);
 }
 
 void Dialog::handleAutoSleepBattery(int value)
 {
-    Common::savePowerSettings("autoSleepBattery", value);
-    updatePM();
+    queueSetting("autoSleepBattery", value);
 }
 
 void Dialog::handleAutoSleepAC(int value)
 {
-    Common::savePowerSettings("autoSleepAC", value);
-    updatePM();
+    queueSetting("autoSleepAC", value);
+}
+
+void Dialog::handleScreenOffBattery(int value)
+{
+    queueSetting("screen_off_battery", value);
+}
+
+void Dialog::handleScreenOffAC(int value)
+{
+    queueSetting("screen_off_ac", value);
+}
+
+void Dialog::handleLockBattery(int value)
+{
+    queueSetting("lock_battery", value);
+}
+
+void Dialog::handleLockAC(int value)
+{
+    queueSetting("lock_ac", value);
+}
+
+void Dialog::handleDimBattery(int value)
+{
+    queueSetting("dim_battery", value);
+}
+
+void Dialog::handleDimAC(int value)
+{
+    queueSetting("dim_ac", value);
+}
+
+void Dialog::handleBrightnessBattery(int value)
+{
+    queueSetting("brightness_battery", value);
+}
+
+void Dialog::handleBrightnessAC(int value)
+{
+    queueSetting("brightness_ac", value);
 }
 
 void Dialog::handleDesktopSS(bool triggered)
 {
-    Common::savePowerSettings("desktop_ss", triggered);
-    updatePM();
+    queueSetting("desktop_ss", triggered);
     QMessageBox::information(this, tr("Restart required"), tr("You must restart the power daemon to apply this setting"));
 }
 
 void Dialog::handleDesktopPM(bool triggered)
 {
-    Common::savePowerSettings("desktop_pm", triggered);
-    updatePM();
+    queueSetting("desktop_pm", triggered);
     QMessageBox::information(this, tr("Restart required"), tr("You must restart the power daemon to apply this setting"));
 }
 
 void Dialog::handleShowNotifications(bool triggered)
 {
-    Common::savePowerSettings("tray_notify", triggered);
-    updatePM();
+    queueSetting("tray_notify", triggered);
 }
 
 void Dialog::handleShowBatteryPercent(bool triggered)
 {
-    Common::savePowerSettings("show_battery_percent", triggered);
-    updatePM();
+    queueSetting("show_battery_percent", triggered);
+}
+
+void Dialog::handleSysfsBackend(bool triggered)
+{
+    queueSetting("sysfs_backend", triggered);
 }
 
 void Dialog::handleShowSystemTray(bool triggered)
 {
-    Common::savePowerSettings("show_tray", triggered);
-    updatePM();
+    queueSetting("show_tray", triggered);
 }
 
 void Dialog::handleDisableLidActionAC(bool triggered)
 {
-    Common::savePowerSettings("disable_lid_action_ac_external_monitor", triggered);
-    updatePM();
+    queueSetting("disable_lid_action_ac_external_monitor", triggered);
 }
 
 void Dialog::handleDisableLidActionBattery(bool triggered)
 {
-    Common::savePowerSettings("disable_lid_action_battery_external_monitor", triggered);
-    updatePM();
+    queueSetting("disable_lid_action_battery_external_monitor", triggered);
 }
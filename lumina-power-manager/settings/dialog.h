@@ -12,6 +12,9 @@
 #include <QComboBox>
 #include <QSpinBox>
 #include <QCheckBox>
+#include <QTimer>
+#include <QVariant>
+#include <QDBusError>
 
 class Dialog : public QDialog
 {
@@ -19,6 +22,7 @@ class Dialog : public QDialog
 
 public:
    explicit Dialog(QWidget *parent = NULL);
+   void done(int r);
 
 private:
     QComboBox *lidActionBattery;
@@ -26,20 +30,35 @@ private:
     QComboBox *criticalActionBattery;
     QSpinBox *lowBattery;
     QSpinBox *criticalBattery;
+    QCheckBox *criticalPredict;
     QSpinBox *autoSleepBattery;
     QSpinBox *autoSleepAC;
+    QSpinBox *screenOffBattery;
+    QSpinBox *screenOffAC;
+    QSpinBox *lockBattery;
+    QSpinBox *lockAC;
+    QSpinBox *dimBattery;
+    QSpinBox *dimAC;
+    QSpinBox *brightnessBattery;
+    QSpinBox *brightnessAC;
     QCheckBox *desktopSS;
     QCheckBox *desktopPM;
     QCheckBox *showNotifications;
     QCheckBox *showBatteryPercent;
+    QCheckBox *sysfsBackend;
     QCheckBox *showSystemTray;
     QCheckBox *disableLidActionAC;
     QCheckBox *disableLidActionBattery;
+    QTimer *applyTimer;
+    QVariantMap pending;
 
 private slots:
     void populate();
     void loadSettings();
-    void updatePM();
+    void queueSetting(const QString &key, const QVariant &value);
+    void applySettings();
+    void handleApplyReply(bool applied);
+    void handleApplyError(const QDBusError &error);
     void setDefaultAction(QComboBox *box, int action);
     void setDefaultAction(QSpinBox *box, int action);
     void handleLidActionBattery(int index);
@@ -47,12 +66,22 @@ private slots:
     void handleCriticalAction(int index);
     void handleLowBattery(int value);
     void handleCriticalBattery(int value);
+    void handleCriticalPredict(bool triggered);
     void handleAutoSleepBattery(int value);
     void handleAutoSleepAC(int value);
+    void handleScreenOffBattery(int value);
+    void handleScreenOffAC(int value);
+    void handleLockBattery(int value);
+    void handleLockAC(int value);
+    void handleDimBattery(int value);
+    void handleDimAC(int value);
+    void handleBrightnessBattery(int value);
+    void handleBrightnessAC(int value);
     void handleDesktopSS(bool triggered);
     void handleDesktopPM(bool triggered);
     void handleShowNotifications(bool triggered);
     void handleShowBatteryPercent(bool triggered);
+    void handleSysfsBackend(bool triggered);
     void handleShowSystemTray(bool triggered);
     void handleDisableLidActionAC(bool triggered);
     void handleDisableLidActionBattery(bool triggered);
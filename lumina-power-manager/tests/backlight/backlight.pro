@@ -0,0 +1,15 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# sysfs backlight fallback on the fixture tree in sysfs/, no X
+TARGET = tst_backlight
+include(../tests.pri)
+SOURCES += tst_backlight.cpp backlight.cpp xconnection.cpp latencytrace.cpp
+HEADERS += backlight.h xconnection.h latencytrace.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += x11 xext xscrnsaver xrandr
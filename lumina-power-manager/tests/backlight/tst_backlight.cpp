@@ -0,0 +1,220 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+
+#include "backlight.h"
+
+// sysfs/ has acpi_video0 (max_brightness 0, skipped) and
+// intel_backlight (937 of 937)
+#define FIXTURE_MAX 937
+
+// sysfs fallback without X: set, clamping and fades. the fixture is
+// copied, the backend keeps the brightness file open
+class TestBacklight : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString root;
+    long readValue();
+    int fadeSteps(Backlight *light, QList<int> *levels);
+    void removeTree();
+
+private slots:
+    void init();
+    void cleanup();
+    void scan();
+    void set_data();
+    void set();
+    void shorterWrite();
+    void fade_data();
+    void fade();
+    void fadeSame();
+    void fadeTimed();
+};
+
+void TestBacklight::init()
+{
+    root = QDir::temp().filePath(QString("lumina-backlight-%1").arg(QCoreApplication::applicationPid()));
+    removeTree();
+    QDir fixture(SRCDIR "sysfs");
+    QStringList devices = fixture.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+    for (int i=0;i<devices.size();++i) {
+        QDir device(fixture.filePath(devices.at(i)));
+        QDir().mkpath(QString("%1/%2").arg(root).arg(devices.at(i)));
+        QStringList files = device.entryList(QDir::Files);
+        for (int j=0;j<files.size();++j) {
+            QString copy = QString("%1/%2/%3").arg(root).arg(devices.at(i)).arg(files.at(j));
+            QVERIFY(QFile::copy(device.filePath(files.at(j)), copy));
+            QFile::setPermissions(copy, QFile::ReadOwner|QFile::WriteOwner);
+        }
+    }
+}
+
+void TestBacklight::cleanup()
+{
+    removeTree();
+}
+
+void TestBacklight::removeTree()
+{
+    QDir dir(root);
+    QStringList devices = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+    for (int i=0;i<devices.size();++i) {
+        QDir device(dir.filePath(devices.at(i)));
+        QStringList files = device.entryList(QDir::Files);
+        for (int j=0;j<files.size();++j) { device.remove(files.at(j)); }
+        dir.rmdir(devices.at(i));
+    }
+    QDir().rmdir(root);
+}
+
+// first line of the brightness file, as the kernel would see it
+long TestBacklight::readValue()
+{
+    QFile file(QString("%1/intel_backlight/brightness").arg(root));
+    if (!file.open(QIODevice::ReadOnly)) { return -1; }
+    return file.readLine().trimmed().toLong();
+}
+
+// run a fade one step at a time, levels gets the brightness after each step
+int TestBacklight::fadeSteps(Backlight *light, QList<int> *levels)
+{
+    int steps = 0;
+    while (light->isFading() && steps<=BACKLIGHT_MAX_STEPS) {
+        QMetaObject::invokeMethod(light, "handleFadeStep");
+        levels->append(light->brightness());
+        steps++;
+    }
+    return steps;
+}
+
+// devices without a max_brightness are skipped
+void TestBacklight::scan()
+{
+    Backlight light(NULL, root);
+    QVERIFY(light.isValid());
+    QCOMPARE(light.brightness(), 100);
+
+    Backlight none(NULL, QDir::temp().filePath("lumina-backlight-none"));
+    QVERIFY(!none.isValid());
+    QCOMPARE(none.brightness(), -1);
+}
+
+void TestBacklight::set_data()
+{
+    QTest::addColumn<int>("percent");
+    QTest::addColumn<long>("value");
+    QTest::addColumn<int>("brightness");
+
+    QTest::newRow("half") << 50 << (long)qRound(FIXTURE_MAX*0.5) << 50;
+    QTest::newRow("one") << 1 << (long)qRound(FIXTURE_MAX*0.01) << 1;
+    QTest::newRow("off") << 0 << 0L << 0;
+    QTest::newRow("full") << 100 << (long)FIXTURE_MAX << 100;
+    QTest::newRow("above max") << 120 << (long)FIXTURE_MAX << 100;
+    QTest::newRow("below zero") << -5 << 0L << 0;
+}
+
+// percent is scaled to max_brightness and clamped
+void TestBacklight::set()
+{
+    QFETCH(int, percent);
+    QFETCH(long, value);
+    QFETCH(int, brightness);
+
+    Backlight light(NULL, root);
+    light.setBrightness(percent);
+    QCOMPARE(readValue(), value);
+    QCOMPARE(light.brightness(), brightness);
+}
+
+// a short value over a longer one still reads back
+void TestBacklight::shorterWrite()
+{
+    Backlight light(NULL, root);
+    light.setBrightness(5);
+    QCOMPARE(readValue(), (long)qRound(FIXTURE_MAX*0.05));
+    QCOMPARE(light.brightness(), 5);
+    light.setBrightness(0);
+    QCOMPARE(readValue(), 0L);
+    QCOMPARE(light.brightness(), 0);
+}
+
+void TestBacklight::fade_data()
+{
+    QTest::addColumn<int>("from");
+    QTest::addColumn<int>("to");
+    QTest::addColumn<int>("msec");
+    QTest::addColumn<int>("steps");
+
+    QTest::newRow("long fade") << 100 << 0 << 5000 << BACKLIGHT_MAX_STEPS;
+    QTest::newRow("frame paced") << 100 << 30 << 160 << 160/BACKLIGHT_FRAME;
+    QTest::newRow("small difference") << 30 << 35 << 1000 << 5;
+    QTest::newRow("instant") << 100 << 50 << 0 << 1;
+    QTest::newRow("above max") << 50 << 150 << 1000 << BACKLIGHT_MAX_STEPS;
+}
+
+// steps are capped by BACKLIGHT_MAX_STEPS, by frames in msec and by
+// the percent difference, and move one way to the target
+void TestBacklight::fade()
+{
+    QFETCH(int, from);
+    QFETCH(int, to);
+    QFETCH(int, msec);
+    QFETCH(int, steps);
+
+    Backlight light(NULL, root);
+    light.setBrightness(from);
+    light.fade(to, msec);
+    QVERIFY(light.isFading());
+
+    QList<int> levels;
+    QCOMPARE(fadeSteps(&light, &levels), steps);
+    QVERIFY(!light.isFading());
+    to = qBound(0, to, 100);
+    QCOMPARE(light.brightness(), to);
+    int last = from;
+    for (int i=0;i<levels.size();++i) {
+        QVERIFY(to<from ? levels.at(i)<=last : levels.at(i)>=last);
+        last = levels.at(i);
+    }
+}
+
+// nothing to do
+void TestBacklight::fadeSame()
+{
+    Backlight light(NULL, root);
+    light.setBrightness(40);
+    light.fade(40, 1000);
+    QVERIFY(!light.isFading());
+    QCOMPARE(light.brightness(), 40);
+}
+
+// a fade on the timer ends at the target, a set stops it
+void TestBacklight::fadeTimed()
+{
+    Backlight light(NULL, root);
+    light.fade(50, 100);
+    QVERIFY(light.isFading());
+    for (int i=0;i<100 && light.isFading();++i) { QTest::qWait(20); }
+    QVERIFY(!light.isFading());
+    QCOMPARE(light.brightness(), 50);
+
+    light.fade(0, 1000);
+    QVERIFY(light.isFading());
+    light.setBrightness(80);
+    QVERIFY(!light.isFading());
+    QCOMPARE(light.brightness(), 80);
+}
+
+QTEST_MAIN(TestBacklight)
+#include "tst_backlight.moc"
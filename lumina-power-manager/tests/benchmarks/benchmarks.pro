@@ -0,0 +1,16 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# daemon hot paths, compare against baseline.csv (see README)
+TARGET = tst_benchmarks
+include(../tests.pri)
+include(../common/daemon.pri)
+QT += gui
+DEFINES += QT_NO_DEBUG_OUTPUT
+SOURCES += tst_benchmarks.cpp iconcache.cpp
+HEADERS += iconcache.h
+RESOURCES += ../../lumina-power-manager.qrc
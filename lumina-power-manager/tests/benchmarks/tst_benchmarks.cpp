@@ -0,0 +1,314 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QEventLoop>
+#include <QVariantMap>
+#include <QTemporaryFile>
+#include <QFile>
+#include <QHash>
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#else
+#include <QApplication>
+#endif
+
+#include "powerdaemon.h"
+#include "iconcache.h"
+#include "fakes.h"
+#include "replaysource.h"
+#include "testenvironment.h"
+
+#include <X11/extensions/Xrandr.h>
+#include <cstring>
+
+// percent a benchmark may be slower than baseline.csv with -compare
+#define BENCH_TOLERANCE 20
+
+// daemon hot paths on fakes and a fixed PowerConfig, see baseline.csv
+class BenchDaemon : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestEnvironment *env;
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+    void checkDevices_data();
+    void checkDevices();
+    void drawBattery_data();
+    void drawBattery();
+    void loadSettings();
+    void displayStorm_data();
+    void displayStorm();
+    void replay();
+};
+
+void BenchDaemon::initTestCase()
+{
+    env = new TestEnvironment();
+}
+
+void BenchDaemon::init()
+{
+    env->reset();
+}
+
+void BenchDaemon::cleanupTestCase()
+{
+    delete env;
+}
+
+void BenchDaemon::checkDevices_data()
+{
+    QTest::addColumn<bool>("changed");
+    QTest::newRow("unchanged") << false;
+    QTest::newRow("changed") << true;
+}
+
+// one device check, with and without a new battery level to publish
+void BenchDaemon::checkDevices()
+{
+    QFETCH(bool, changed);
+
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    power.setBattery(50, true);
+    QCoreApplication::processEvents();
+
+    double level = 50;
+    QBENCHMARK {
+        if (changed) {
+            level = level>10?level-0.1:90;
+            power.setLevel(level);
+        }
+        QMetaObject::invokeMethod(&daemon, "checkDevices");
+    }
+}
+
+void BenchDaemon::drawBattery_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("render") << false;
+    QTest::newRow("cached") << true;
+}
+
+// tray icon for a battery level, rendered or from the cache
+void BenchDaemon::drawBattery()
+{
+    QFETCH(bool, cached);
+
+    IconCache icons;
+    int percent = 0;
+    QBENCHMARK {
+        if (!cached) { percent = (percent+1)%101; }
+        quint32 key = IconCache::key(IconCache::stateGood, false, percent, 1.0);
+        QIcon icon = icons.icon(key);
+        if (!cached) { icons = IconCache(); }
+        Q_UNUSED(icon)
+    }
+}
+
+// settings file reload (ConfigWatcher), every setting differs from the defaults
+void BenchDaemon::loadSettings()
+{
+    QVariantMap values;
+    values["autoSleepBattery"] = 10;
+    values["autoSleepAC"] = 30;
+    values["lowBattery"] = 20;
+    values["criticalBattery"] = 8;
+    values["lidBattery"] = lidSleep;
+    values["lidAC"] = lidLock;
+    values["criticalAction"] = criticalHibernate;
+    values["screen_off_battery"] = 5;
+    values["lock_battery"] = 6;
+    values["dim_battery"] = 3;
+    values["brightness_battery"] = 40;
+    PowerConfig::save(values);
+
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    QCoreApplication::processEvents();
+
+    QBENCHMARK {
+        QMetaObject::invokeMethod(&daemon, "loadSettings");
+    }
+}
+
+void BenchDaemon::displayStorm_data()
+{
+    QTest::addColumn<int>("events");
+    QTest::newRow("dock") << 12;
+    QTest::newRow("storm") << 200;
+}
+
+// a burst of RandR output events merged by HotPlug, settled and
+// applied by the daemon (profile restore or auto layout).
+// the settle timer is skipped, the burst is settled right away.
+// needs an X display with RandR, the layout is applied to it
+void BenchDaemon::displayStorm()
+{
+    QFETCH(int, events);
+
+    XConnection probe;
+    if (!probe.isValid() || probe.randrEventBase()<0) {
+#if QT_VERSION >= 0x050000
+        QSKIP("needs an X display with RandR");
+#else
+        QSKIP("needs an X display with RandR", SkipSingle);
+#endif
+    }
+
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    QVERIFY(QMetaObject::invokeMethod(&daemon, "startDeferred"));
+    HotPlug *ht = daemon.hotPlug();
+    QVERIFY(ht);
+
+    QList<unsigned long> outputs;
+    QMapIterator<QString, TopologyOutput> i(ht->topology().outputs);
+    while (i.hasNext()) {
+        i.next();
+        outputs << i.value().id;
+    }
+    QVERIFY(!outputs.isEmpty());
+
+    XEvent ev;
+    memset(&ev, 0, sizeof(ev));
+    XRROutputChangeNotifyEvent *notify = (XRROutputChangeNotifyEvent*)&ev;
+    notify->type = probe.randrEventBase()+RRNotify;
+    notify->subtype = RRNotify_OutputChange;
+    QBENCHMARK {
+        for (int e=0;e<events;++e) {
+            notify->output = outputs.at(e%outputs.size());
+            QMetaObject::invokeMethod(ht, "handleEvent", Q_ARG(XEvent*, &ev));
+        }
+        QMetaObject::invokeMethod(ht, "handleSettled");
+        // the same monitors are still connected, apply as a dock would
+        QMetaObject::invokeMethod(&daemon, "handleDisplays",
+                                  QArgument<QMap<QString,bool> >("QMap<QString,bool>", ht->topology().connections()),
+                                  Q_ARG(int, events));
+    }
+}
+
+// whole recorded session (tests/daemon/traces/session.trace)
+void BenchDaemon::replay()
+{
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    FakeTopology topology;
+    FakeIdle idle;
+    FakeInhibitor player(daemon.inhibitRegistry(), InhibitRegistry::kindSleep, ":1.10");
+    FakeInhibitor browser(daemon.inhibitRegistry(), InhibitRegistry::kindScreenSaver, ":1.11");
+    daemon.connectDisplays(&topology);
+    daemon.connectIdle(&idle);
+
+    QBENCHMARK {
+        ReplaySource source;
+        QVERIFY(source.load(SRCDIR "../daemon/traces/session.trace"));
+        connect(&source, SIGNAL(timeChanged(qint64)), &power, SLOT(setTime(qint64)));
+        connect(&source, SIGNAL(battery(double,bool)), &power, SLOT(setBattery(double,bool)));
+        connect(&source, SIGNAL(lidClosed()), &power, SLOT(closeLid()));
+        connect(&source, SIGNAL(lidOpened()), &power, SLOT(openLid()));
+        connect(&source, SIGNAL(displays(QMap<QString,bool>,int)), &topology, SIGNAL(changed(QMap<QString,bool>,int)));
+        connect(&source, SIGNAL(idleStage(int)), &idle, SIGNAL(stageReached(int)));
+        connect(&source, SIGNAL(idleResumed(int)), &idle, SIGNAL(resumed(int)));
+        connect(&source, SIGNAL(inhibited(int,bool)), &player, SLOT(setInhibited(int,bool)));
+        connect(&source, SIGNAL(inhibited(int,bool)), &browser, SLOT(setInhibited(int,bool)));
+        QEventLoop loop;
+        connect(&source, SIGNAL(finished()), &loop, SLOT(quit()));
+        source.start();
+        loop.exec();
+        QCoreApplication::processEvents();
+    }
+}
+
+// "function","tag","metric",value per iteration,total,iterations
+static QHash<QString, double> readResults(const QString &fileName)
+{
+    QHash<QString, double> result;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text)) { return result; }
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith("#")) { continue; }
+        QStringList fields = line.split(",");
+        if (fields.size()<4) { continue; }
+        bool ok = false;
+        double value = fields.at(3).toDouble(&ok);
+        if (ok) { result[QStringList(fields.mid(0, 3)).join(",")] = value; }
+    }
+    return result;
+}
+
+// number of benchmarks slower than the baseline by more than tolerance percent
+static int compareResults(const QString &fileName, const QString &baselineName, double tolerance)
+{
+    QHash<QString, double> results = readResults(fileName);
+    QHash<QString, double> baseline = readResults(baselineName);
+    int slower = 0;
+    QHashIterator<QString, double> i(results);
+    while (i.hasNext()) {
+        i.next();
+        if (!baseline.contains(i.key())) {
+            qWarning("no baseline: %s %g", qPrintable(i.key()), i.value());
+            continue;
+        }
+        double limit = baseline.value(i.key())*(1.0+tolerance/100.0);
+        if (i.value()>limit) {
+            qWarning("SLOWER: %s %g, baseline %g", qPrintable(i.key()), i.value(), baseline.value(i.key()));
+            slower++;
+        }
+    }
+    qWarning("%d of %d benchmarks slower than baseline (+%g%%)", slower, results.size(), tolerance);
+    return slower;
+}
+
+// icons need a gui application, but not a display.
+// -compare [percent] fails if a benchmark is slower than baseline.csv
+int main(int argc, char *argv[])
+{
+#if QT_VERSION >= 0x050000
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty()) { qputenv("QT_QPA_PLATFORM", "offscreen"); }
+    QGuiApplication app(argc, argv);
+#else
+    QApplication app(argc, argv);
+#endif
+    BenchDaemon bench;
+    QStringList args = app.arguments();
+    int compare = args.indexOf("-compare");
+    if (compare<0) { return QTest::qExec(&bench, args); }
+
+    double tolerance = BENCH_TOLERANCE;
+    args.removeAt(compare);
+    if (compare<args.size()) {
+        bool ok = false;
+        double value = args.at(compare).toDouble(&ok);
+        if (ok) {
+            tolerance = value;
+            args.removeAt(compare);
+        }
+    }
+    QTemporaryFile results;
+    if (!results.open()) { return 1; }
+    results.close();
+    args << "-csv" << "-o" << results.fileName();
+    int result = QTest::qExec(&bench, args);
+    if (result) { return result; }
+    return compareResults(results.fileName(), SRCDIR "baseline.csv", tolerance)>0?1:0;
+}
+
+#include "tst_benchmarks.moc"
@@ -0,0 +1,14 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# the daemon on fake backends, include after tests.pri
+SOURCES += powerdaemon.cpp powerbackend.cpp xconnection.cpp topology.cpp hotplug.cpp layout.cpp profilestore.cpp batteryhistory.cpp kernellog.cpp policy.cpp latencytrace.cpp idletimer.cpp idlescheduler.cpp dpms.cpp backlight.cpp powersupply.cpp configwatcher.cpp powerservice.cpp powermetrics.cpp inhibitregistry.cpp inhibitservice.cpp fakes.cpp replaysource.cpp testenvironment.cpp
+HEADERS += powerdaemon.h powerbackend.h xconnection.h topology.h hotplug.h layout.h profilestore.h batteryhistory.h kernellog.h policy.h latencytrace.h idletimer.h idlescheduler.h dpms.h backlight.h powersupply.h configwatcher.h powerservice.h powermetrics.h inhibitregistry.h inhibitservice.h fakes.h replaysource.h testenvironment.h
+LIBS += -L$$OUT_PWD/../../lib -lPower
+
+CONFIG += link_pkgconfig
+PKGCONFIG += x11 xext xscrnsaver xrandr
@@ -0,0 +1,147 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "fakes.h"
+
+FakePower::FakePower(QObject *parent) :
+    PowerBackend(parent)
+  , locks(0)
+  , suspends(0)
+  , hibernates(0)
+  , shutdowns(0)
+  , fail(false)
+  , level(-1)
+  , battery(false)
+  , time(0)
+{
+}
+
+bool FakePower::onBattery()
+{
+    return battery;
+}
+
+double FakePower::batteryLeft()
+{
+    return qMax(level, 0.0);
+}
+
+bool FakePower::lockScreen()
+{
+    locks++;
+    return !fail;
+}
+
+bool FakePower::suspend()
+{
+    suspends++;
+    return !fail;
+}
+
+bool FakePower::hibernate()
+{
+    hibernates++;
+    return !fail;
+}
+
+bool FakePower::shutdown()
+{
+    shutdowns++;
+    return !fail;
+}
+
+qint64 FakePower::now()
+{
+    if (time>0) { return time; }
+    return PowerBackend::now();
+}
+
+// switches are sent like UPower does, before the device update.
+// starts on AC, so a trace starting on battery is a switch
+void FakePower::setBattery(double percent, bool discharging)
+{
+    bool switched = discharging != battery;
+    level = percent;
+    battery = discharging;
+    if (switched) {
+        if (battery) { emit switchedToBattery(); }
+        else { emit switchedToAC(); }
+    }
+    emit updatedDevices();
+}
+
+void FakePower::setLevel(double percent)
+{
+    setBattery(percent, battery);
+}
+
+void FakePower::setTime(qint64 msec)
+{
+    time = msec;
+}
+
+void FakePower::closeLid()
+{
+    emit closedLid();
+}
+
+void FakePower::openLid()
+{
+    emit openedLid();
+}
+
+FakeTopology::FakeTopology(QObject *parent) :
+    QObject(parent)
+{
+}
+
+void FakeTopology::setOutput(const QString &name, bool connected, int events)
+{
+    QMap<QString,bool> displays;
+    displays[name] = connected;
+    emit changed(displays, events);
+}
+
+FakeIdle::FakeIdle(QObject *parent) :
+    QObject(parent)
+{
+}
+
+FakeInhibitor::FakeInhibitor(InhibitRegistry *inhibitors, InhibitRegistry::Kind type, const QString &name, QObject *parent) :
+    QObject(parent)
+  , registry(inhibitors)
+  , kind(type)
+  , owner(name)
+  , cookie(0)
+{
+}
+
+void FakeInhibitor::setInhibited(bool inhibited)
+{
+    if (inhibited == (cookie != 0)) { return; }
+    if (inhibited) { cookie = registry->inhibit(kind, owner, "fake", "test"); }
+    else {
+        registry->uninhibit(kind, cookie, owner);
+        cookie = 0;
+    }
+}
+
+// only follows its own kind, see ReplaySource::inhibited
+void FakeInhibitor::setInhibited(int type, bool inhibited)
+{
+    if (type != kind) { return; }
+    setInhibited(inhibited);
+}
+
+// the client leaves the bus without UnInhibit
+void FakeInhibitor::exit()
+{
+    QMetaObject::invokeMethod(registry, "handleOwnerGone", Q_ARG(QString, owner));
+    cookie = 0;
+}
@@ -0,0 +1,103 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef FAKES_H
+#define FAKES_H
+
+#include <QObject>
+#include <QMap>
+#include <QString>
+
+#include "powerbackend.h"
+#include "inhibitregistry.h"
+
+// battery and lid without UPower, session actions are only counted.
+// time is virtual once set, see ReplaySource::timeChanged
+class FakePower : public PowerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit FakePower(QObject *parent = NULL);
+    bool onBattery();
+    double batteryLeft();
+    bool lockScreen();
+    bool suspend();
+    bool hibernate();
+    bool shutdown();
+    qint64 now();
+    int locks;
+    int suspends;
+    int hibernates;
+    int shutdowns;
+    bool fail;
+
+private:
+    double level;
+    bool battery;
+    qint64 time;
+
+public slots:
+    void setBattery(double percent, bool discharging);
+    void setLevel(double percent);
+    void setTime(qint64 msec);
+    void closeLid();
+    void openLid();
+};
+
+// monitor changes without X, same signals as HotPlug
+class FakeTopology : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FakeTopology(QObject *parent = NULL);
+
+signals:
+    void changed(QMap<QString,bool> displays, int events);
+    void found(QMap<QString,bool> displays);
+
+public slots:
+    void setOutput(const QString &name, bool connected, int events = 1);
+};
+
+// idle stages without X, same signals as IdleScheduler
+class FakeIdle : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FakeIdle(QObject *parent = NULL);
+
+signals:
+    void stageReached(int stage);
+    void resumed(int stages);
+};
+
+// one D-Bus client holding an inhibitor
+class FakeInhibitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    FakeInhibitor(InhibitRegistry *inhibitors, InhibitRegistry::Kind type, const QString &name, QObject *parent = NULL);
+
+private:
+    InhibitRegistry *registry;
+    InhibitRegistry::Kind kind;
+    QString owner;
+    quint32 cookie;
+
+public slots:
+    void setInhibited(bool inhibited);
+    void setInhibited(int type, bool inhibited);
+    void exit();
+};
+
+#endif // FAKES_H
@@ -0,0 +1,276 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "replaysource.h"
+#include "tracering.h"
+#include "inhibitregistry.h"
+
+#include <QFile>
+#include <QTimer>
+#include <QDateTime>
+#include <QStringList>
+
+#include <limits.h>
+
+ReplaySource::ReplaySource(QObject *parent) :
+    QObject(parent)
+  , index(0)
+  , speed(0)
+  , clock(0)
+  , percent(100)
+  , onBattery(false)
+  , idleStages(0)
+  , wallTime(0)
+{
+}
+
+// trace ring dump if it has the magic, else text
+bool ReplaySource::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+    QByteArray data = file.readAll();
+    events.clear();
+    if (loadDump(data)) { return true; }
+    return loadText(data);
+}
+
+// <seconds> <event> [args], # starts a comment
+//   battery <percent> [0|1]   percent and on battery
+//   ac <0|1>
+//   lid <closed|open>
+//   display <output> <0|1>
+//   idle <dim|screen_off|lock|suspend>
+//   active
+//   inhibit <0|1> [sleep|screensaver]
+bool ReplaySource::loadText(const QByteArray &data)
+{
+    static const char *stages[] = { "dim", "screen_off", "lock", "suspend", NULL };
+    qint64 base = QDateTime::currentMSecsSinceEpoch();
+    QList<QByteArray> lines = data.split('\n');
+    for (int i=0;i<lines.size();++i) {
+        QString line = QString::fromUtf8(lines.at(i)).section('#', 0, 0).simplified();
+        if (line.isEmpty()) { continue; }
+        QStringList args = line.split(' ');
+        // time and type first, a short line is bad whatever follows
+        bool ok = false;
+        ReplayEvent event;
+        if (args.size()>=2) { event.time = base+qRound64(args.at(0).toDouble(&ok)*1000); }
+        QString type = ok?args.at(1):QString();
+        if (type == "battery" && args.size()>=3) {
+            event.type = typeBattery;
+            event.value = args.at(2).toDouble(&ok);
+            event.name = args.value(3);
+        } else if (type == "ac" && args.size()>=3) {
+            event.type = typeAC;
+            event.value = args.at(2).toInt(&ok);
+        } else if (type == "lid" && args.size()>=3) {
+            event.type = args.at(2) == "open"?typeLidOpened:typeLidClosed;
+        } else if (type == "display" && args.size()>=4) {
+            event.type = typeDisplay;
+            event.name = args.at(2);
+            event.value = args.at(3).toInt(&ok);
+        } else if (type == "idle" && args.size()>=3) {
+            event.type = typeIdle;
+            event.value = -1;
+            for (int j=0;stages[j];++j) {
+                if (args.at(2) == stages[j]) { event.value = j; }
+            }
+            if (event.value<0) { ok = false; }
+        } else if (type == "active") {
+            event.type = typeActive;
+        } else if (type == "inhibit" && args.size()>=3) {
+            event.type = typeInhibit;
+            event.value = args.at(2).toInt(&ok);
+            event.name = args.value(3, InhibitRegistry::kindName(InhibitRegistry::kindSleep));
+            if (event.name != InhibitRegistry::kindName(InhibitRegistry::kindSleep) &&
+                event.name != InhibitRegistry::kindName(InhibitRegistry::kindScreenSaver)) { ok = false; }
+        } else { ok = false; }
+        if (!ok) {
+            qWarning("replay: bad line %d: %s", i+1, qPrintable(line));
+            return false;
+        }
+        events << event;
+    }
+    return !events.isEmpty();
+}
+
+// inputs recorded by a running daemon, with their wall clock time
+bool ReplaySource::loadDump(const QByteArray &data)
+{
+    TraceHeader header;
+    QList<TraceRecord> records = TraceRing::records(data, &header);
+    if (records.isEmpty()) { return false; }
+    int held[InhibitRegistry::kindCount] = { 0, 0 };
+    for (int i=0;i<records.size();++i) {
+        const TraceRecord &record = records.at(i);
+        ReplayEvent event;
+        event.time = (header.realtime+(record.timestamp-header.monotonic))/1000000;
+        switch(record.event) {
+        case tracePowerState:
+            event.type = typeBattery;
+            event.value = record.args[0]/10.0;
+            event.name = QString::number(record.args[2]);
+            break;
+        case tracePowerLidClosed:
+            event.type = typeLidClosed;
+            break;
+        case tracePowerLidOpened:
+            event.type = typeLidOpened;
+            break;
+        case tracePowerIdleStage:
+            event.type = typeIdle;
+            event.value = record.args[0];
+            break;
+        case tracePowerIdleResumed:
+            event.type = typeActive;
+            break;
+        // first inhibitor of a kind in, last one out
+        case tracePowerInhibitAdd:
+        case tracePowerInhibitRemove:
+        {
+            int kind = record.args[1];
+            if (kind<0 || kind>=InhibitRegistry::kindCount) { continue; }
+            bool add = record.event == tracePowerInhibitAdd;
+            held[kind] = qMax(0, held[kind]+(add?1:-1));
+            if (held[kind] != (add?1:0)) { continue; }
+            event.type = typeInhibit;
+            event.value = add;
+            event.name = InhibitRegistry::kindName(kind);
+            break;
+        }
+        default:
+            continue;
+        }
+        events << event;
+    }
+    return !events.isEmpty();
+}
+
+void ReplaySource::setSpeed(double value)
+{
+    speed = value;
+}
+
+int ReplaySource::size()
+{
+    return events.size();
+}
+
+// virtual time, msec since epoch
+qint64 ReplaySource::now()
+{
+    return clock;
+}
+
+void ReplaySource::start()
+{
+    index = 0;
+    idleStages = 0;
+    wall.start();
+    QTimer::singleShot(0, this, SLOT(next()));
+}
+
+// one event per event loop turn, so the daemon can merge updates as it does live
+void ReplaySource::next()
+{
+    if (index>=events.size()) {
+        wallTime = wall.elapsed();
+        emit finished();
+        return;
+    }
+    const ReplayEvent &event = events.at(index++);
+    clock = event.time;
+    emit timeChanged(clock);
+    QElapsedTimer timer;
+    timer.start();
+    send(event);
+    handlers[event.type].add(timer.nsecsElapsed()/1000);
+
+    qint64 delay = 0;
+    if (speed>0 && index<events.size()) { delay = (qint64)((events.at(index).time-event.time)/speed); }
+    QTimer::singleShot((int)qBound((qint64)0, delay, (qint64)INT_MAX), this, SLOT(next()));
+}
+
+void ReplaySource::send(const ReplayEvent &event)
+{
+    switch(event.type) {
+    case typeBattery:
+        percent = event.value;
+        if (!event.name.isEmpty()) { onBattery = event.name.toInt(); }
+        emit battery(percent, onBattery);
+        break;
+    case typeAC:
+        onBattery = !event.value;
+        emit battery(percent, onBattery);
+        break;
+    case typeLidClosed:
+        emit lidClosed();
+        break;
+    case typeLidOpened:
+        emit lidOpened();
+        break;
+    case typeDisplay:
+    {
+        QMap<QString,bool> changed;
+        changed[event.name] = event.value != 0;
+        emit displays(changed, 1);
+        break;
+    }
+    case typeIdle:
+        idleStages |= 1<<(int)event.value;
+        emit idleStage((int)event.value);
+        break;
+    case typeActive:
+        emit idleResumed(idleStages);
+        idleStages = 0;
+        break;
+    case typeInhibit:
+        emit inhibited(event.name == InhibitRegistry::kindName(InhibitRegistry::kindScreenSaver)?
+                           InhibitRegistry::kindScreenSaver:InhibitRegistry::kindSleep, event.value != 0);
+        break;
+    default: ;
+    }
+}
+
+const char *ReplaySource::typeName(int type)
+{
+    switch(type) {
+    case typeBattery: return "battery";
+    case typeAC: return "ac";
+    case typeLidClosed: return "lid_closed";
+    case typeLidOpened: return "lid_opened";
+    case typeDisplay: return "display";
+    case typeIdle: return "idle";
+    case typeActive: return "active";
+    case typeInhibit: return "inhibit";
+    default: ;
+    }
+    return "unknown";
+}
+
+// event count, virtual vs wall time and time spent per event type
+QString ReplaySource::summary()
+{
+    QString result;
+    qint64 span = events.isEmpty()?0:events.last().time-events.first().time;
+    result.append(QString("replay: %1 events, %2 s virtual in %3 ms\n")
+                  .arg(events.size()).arg(span/1000.0).arg(wallTime));
+    result.append(QString("%1 %2 %3 %4\n").arg("event", -12).arg("count", 8).arg("mean_us", 10).arg("max_us", 10));
+    for (int i=0;i<typeCount;++i) {
+        const LatencyHistogram &histogram = handlers[i];
+        if (histogram.count == 0) { continue; }
+        result.append(QString("%1 %2 %3 %4\n").arg(typeName(i), -12).arg(histogram.count, 8)
+                      .arg((double)histogram.sum/histogram.count, 10, 'f', 1).arg(histogram.max, 10));
+    }
+    return result;
+}
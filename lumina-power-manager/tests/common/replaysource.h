@@ -0,0 +1,100 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QElapsedTimer>
+
+#include "latencytrace.h"
+
+// one recorded input, time is msec since epoch
+struct ReplayEvent
+{
+    qint64 time;
+    int type;
+    double value;
+    QString name;
+
+    ReplayEvent()
+        : time(0)
+        , type(0)
+        , value(0)
+    {
+    }
+};
+
+// recorded battery, lid, display, idle and inhibitor events for the fakes.
+// events come from a text trace or a trace ring dump and are sent in
+// virtual time, speed is the speedup (0 is as fast as possible).
+// the time spent in the daemon for each event is kept per type.
+class ReplaySource : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Type
+    {
+        typeBattery,
+        typeAC,
+        typeLidClosed,
+        typeLidOpened,
+        typeDisplay,
+        typeIdle,
+        typeActive,
+        typeInhibit,
+        typeCount
+    };
+
+    explicit ReplaySource(QObject *parent = NULL);
+    bool load(const QString &fileName);
+    void setSpeed(double value);
+    int size();
+    qint64 now();
+    QString summary();
+    static const char *typeName(int type);
+
+signals:
+    void timeChanged(qint64 msec);
+    void battery(double percent, bool onBattery);
+    void lidClosed();
+    void lidOpened();
+    void displays(QMap<QString,bool> displays, int events);
+    void idleStage(int stage);
+    void idleResumed(int stages);
+    void inhibited(int kind, bool inhibited);
+    void finished();
+
+public slots:
+    void start();
+
+private:
+    QList<ReplayEvent> events;
+    int index;
+    double speed;
+    qint64 clock;
+    double percent;
+    bool onBattery;
+    int idleStages;
+    QElapsedTimer wall;
+    qint64 wallTime;
+    LatencyHistogram handlers[typeCount];
+    bool loadText(const QByteArray &data);
+    bool loadDump(const QByteArray &data);
+    void send(const ReplayEvent &event);
+
+private slots:
+    void next();
+};
+
+#endif // REPLAYSOURCE_H
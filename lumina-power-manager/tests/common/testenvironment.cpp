@@ -0,0 +1,44 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "testenvironment.h"
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QStringList>
+#include <QDir>
+
+TestEnvironment::TestEnvironment()
+{
+    dir = QDir::temp().filePath(QString("lumina-power-tests-%1").arg(QCoreApplication::applicationPid()));
+    QDir().mkpath(dir);
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, dir);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, dir);
+    reset();
+}
+
+TestEnvironment::~TestEnvironment()
+{
+    reset();
+    QDir().rmdir(QDir(dir).filePath("lumina-desktop"));
+    QDir().rmdir(dir);
+}
+
+QString TestEnvironment::path() const
+{
+    return dir;
+}
+
+// remove everything written by the previous test
+void TestEnvironment::reset()
+{
+    QDir data(QDir(dir).filePath("lumina-desktop"));
+    QStringList files = data.entryList(QDir::Files|QDir::Hidden);
+    for (int i=0;i<files.size();++i) { data.remove(files.at(i)); }
+}
@@ -0,0 +1,29 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef TESTENVIRONMENT_H
+#define TESTENVIRONMENT_H
+
+#include <QString>
+
+// settings, battery history and display profiles go to a scratch
+// dir instead of ~/.config, create before anything uses QSettings
+class TestEnvironment
+{
+public:
+    TestEnvironment();
+    ~TestEnvironment();
+    QString path() const;
+    void reset();
+
+private:
+    QString dir;
+};
+
+#endif // TESTENVIRONMENT_H
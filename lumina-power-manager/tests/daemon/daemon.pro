@@ -0,0 +1,12 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# daemon decisions for recorded traces (traces/)
+TARGET = tst_daemon
+include(../tests.pri)
+include(../common/daemon.pri)
+SOURCES += tst_daemon.cpp
@@ -0,0 +1,180 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QEventLoop>
+#include <QElapsedTimer>
+
+#include "powerdaemon.h"
+#include "fakes.h"
+#include "replaysource.h"
+#include "testenvironment.h"
+
+// no X events during the teardown test, msec
+#define TEARDOWN_QUIET 200
+#define TEARDOWN_MAX 1000
+
+// the daemon on fakes, settings are fixed so results don't depend on ~/.config
+class TestDaemon : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestEnvironment *env;
+    void replay(PowerDaemon *daemon, FakePower *power, const QString &trace);
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+    void traces_data();
+    void traces();
+    void coalesce();
+    void ownerGone();
+    void teardown();
+};
+
+void TestDaemon::initTestCase()
+{
+    env = new TestEnvironment();
+}
+
+void TestDaemon::init()
+{
+    env->reset();
+}
+
+void TestDaemon::cleanupTestCase()
+{
+    delete env;
+}
+
+// run a trace to the end, including the last device check
+void TestDaemon::replay(PowerDaemon *daemon, FakePower *power, const QString &trace)
+{
+    ReplaySource source;
+    QVERIFY(source.load(QString(SRCDIR "traces/%1").arg(trace)));
+    FakeTopology topology;
+    FakeIdle idle;
+    FakeInhibitor player(daemon->inhibitRegistry(), InhibitRegistry::kindSleep, ":1.10");
+    FakeInhibitor browser(daemon->inhibitRegistry(), InhibitRegistry::kindScreenSaver, ":1.11");
+    daemon->connectDisplays(&topology);
+    daemon->connectIdle(&idle);
+    connect(&source, SIGNAL(timeChanged(qint64)), power, SLOT(setTime(qint64)));
+    connect(&source, SIGNAL(battery(double,bool)), power, SLOT(setBattery(double,bool)));
+    connect(&source, SIGNAL(lidClosed()), power, SLOT(closeLid()));
+    connect(&source, SIGNAL(lidOpened()), power, SLOT(openLid()));
+    connect(&source, SIGNAL(displays(QMap<QString,bool>,int)), &topology, SIGNAL(changed(QMap<QString,bool>,int)));
+    connect(&source, SIGNAL(idleStage(int)), &idle, SIGNAL(stageReached(int)));
+    connect(&source, SIGNAL(idleResumed(int)), &idle, SIGNAL(resumed(int)));
+    connect(&source, SIGNAL(inhibited(int,bool)), &player, SLOT(setInhibited(int,bool)));
+    connect(&source, SIGNAL(inhibited(int,bool)), &browser, SLOT(setInhibited(int,bool)));
+
+    QEventLoop loop;
+    connect(&source, SIGNAL(finished()), &loop, SLOT(quit()));
+    source.start();
+    loop.exec();
+    QCoreApplication::processEvents();
+}
+
+void TestDaemon::traces_data()
+{
+    QTest::addColumn<QString>("trace");
+    QTest::addColumn<int>("critical");
+    QTest::addColumn<int>("locks");
+    QTest::addColumn<int>("suspends");
+    QTest::addColumn<int>("hibernates");
+    QTest::addColumn<int>("shutdowns");
+
+    QTest::newRow("lid") << "lid.trace" << (int)criticalNone << 1 << 1 << 0 << 0;
+    QTest::newRow("inhibit") << "inhibit.trace" << (int)criticalNone << 1 << 1 << 0 << 0;
+    QTest::newRow("screensaver") << "screensaver.trace" << (int)criticalNone << 0 << 1 << 0 << 0;
+    QTest::newRow("critical") << "critical.trace" << (int)criticalHibernate << 0 << 0 << 1 << 0;
+    QTest::newRow("critical shutdown") << "critical.trace" << (int)criticalShutdown << 0 << 0 << 0 << 1;
+}
+
+// session actions requested for a trace
+void TestDaemon::traces()
+{
+    QFETCH(QString, trace);
+    QFETCH(int, critical);
+
+    PowerConfig config;
+    config.criticalAction = critical;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    replay(&daemon, &power, trace);
+
+    QTEST(power.locks, "locks");
+    QTEST(power.suspends, "suspends");
+    QTEST(power.hibernates, "hibernates");
+    QTEST(power.shutdowns, "shutdowns");
+}
+
+// updates from one event loop turn are one check
+void TestDaemon::coalesce()
+{
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    QCoreApplication::processEvents();
+    int checks = daemon.powerMetrics()->value(PowerMetrics::counterStateUpdates)-
+                 daemon.powerMetrics()->value(PowerMetrics::counterStateMerged);
+
+    for (int i=0;i<10;++i) { power.setBattery(50, true); }
+    QCoreApplication::processEvents();
+    QCOMPARE(daemon.powerMetrics()->value(PowerMetrics::counterStateUpdates)-
+             daemon.powerMetrics()->value(PowerMetrics::counterStateMerged), checks+1);
+}
+
+// a client that leaves the bus releases its inhibitor
+void TestDaemon::ownerGone()
+{
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon daemon(NULL, &power, &config);
+    FakeInhibitor player(daemon.inhibitRegistry(), InhibitRegistry::kindSleep, ":1.20");
+    player.setInhibited(true);
+    QVERIFY(daemon.inhibitRegistry()->hasInhibit());
+    player.exit();
+    QVERIFY(!daemon.inhibitRegistry()->hasInhibit());
+    QCOMPARE(daemon.inhibitRegistry()->size(), 0);
+}
+
+// shutdown with X running but quiet must not wait for an event
+void TestDaemon::teardown()
+{
+    {
+        XConnection probe;
+        if (!probe.isValid()) {
+#if QT_VERSION >= 0x050000
+            QSKIP("needs an X display");
+#else
+            QSKIP("needs an X display", SkipSingle);
+#endif
+        }
+    }
+
+    PowerConfig config;
+    FakePower power;
+    PowerDaemon *daemon = new PowerDaemon(NULL, &power, &config);
+    QVERIFY(QMetaObject::invokeMethod(daemon, "startDeferred"));
+    QElapsedTimer quiet;
+    quiet.start();
+    while (quiet.elapsed()<TEARDOWN_QUIET) { QCoreApplication::processEvents(QEventLoop::AllEvents, TEARDOWN_QUIET); }
+
+    QElapsedTimer timer;
+    timer.start();
+    delete daemon;
+    QCoreApplication::processEvents();
+    QVERIFY2(timer.elapsed()<TEARDOWN_MAX, qPrintable(QString("teardown took %1 ms").arg(timer.elapsed())));
+}
+
+QTEST_MAIN(TestDaemon)
+#include "tst_daemon.moc"
@@ -0,0 +1,12 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# battery history on synthetic discharge traces
+TARGET = tst_history
+include(../tests.pri)
+SOURCES += tst_history.cpp batteryhistory.cpp kernellog.cpp testenvironment.cpp
+HEADERS += batteryhistory.h kernellog.h testenvironment.h
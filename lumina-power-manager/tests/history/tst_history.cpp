@@ -0,0 +1,206 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QFile>
+
+#include "batteryhistory.h"
+#include "kernellog.h"
+#include "testenvironment.h"
+
+// any fixed point in time, samples are a minute apart
+#define HISTORY_EPOCH 1500000000000LL
+#define HISTORY_MINUTE 60000LL
+
+// rates, estimates and critical action learning on synthetic discharge traces
+class TestHistory : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestEnvironment *env;
+    QString file;
+    qint64 discharge(BatteryHistory *history, double from, double perHour, int minutes, qint64 start);
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+    void steadyDischarge();
+    void gapNotLearned();
+    void charging();
+    void persisted();
+    void critical_data();
+    void critical();
+    void actionLearning_data();
+    void actionLearning();
+    void actionCancelled();
+    void actionStale();
+    void imageWriteTime_data();
+    void imageWriteTime();
+};
+
+void TestHistory::initTestCase()
+{
+    env = new TestEnvironment();
+    file = QString("%1/history.dat").arg(env->path());
+}
+
+void TestHistory::init()
+{
+    QFile::remove(file);
+}
+
+void TestHistory::cleanupTestCase()
+{
+    QFile::remove(file);
+    delete env;
+}
+
+// one sample a minute at a constant rate, returns the time after the last sample
+qint64 TestHistory::discharge(BatteryHistory *history, double from, double perHour, int minutes, qint64 start)
+{
+    for (int i=0;i<=minutes;++i) { history->addSample(from-perHour*i/60.0, false, start+i*HISTORY_MINUTE); }
+    return start+(minutes+1)*HISTORY_MINUTE;
+}
+
+void TestHistory::steadyDischarge()
+{
+    BatteryHistory history(file);
+    QVERIFY(history.isValid());
+    discharge(&history, 100, 10, 120, HISTORY_EPOCH);
+    QCOMPARE(history.count(), 121);
+    QVERIFY(qAbs(history.dischargeRate()-10) < 0.1);
+    // 80% at 10%/h
+    QVERIFY(qAbs(history.timeToEmpty()-8*3600) < 300);
+    QCOMPARE(history.timeToFull(), (qint64)-1);
+}
+
+// suspend or power off between samples, the drop is not a rate
+void TestHistory::gapNotLearned()
+{
+    BatteryHistory history(file);
+    qint64 next = discharge(&history, 100, 10, 60, HISTORY_EPOCH);
+    double rate = history.dischargeRate();
+    history.addSample(60, false, next+2*3600*1000);
+    QCOMPARE(history.dischargeRate(), rate);
+}
+
+void TestHistory::charging()
+{
+    BatteryHistory history(file);
+    qint64 next = discharge(&history, 50, 10, 30, HISTORY_EPOCH);
+    double rate = history.dischargeRate();
+    for (int i=0;i<=60;++i) { history.addSample(45+i*0.5, true, next+i*HISTORY_MINUTE); }
+    QCOMPARE(history.dischargeRate(), rate);
+    QVERIFY(qAbs(history.chargeRate()-30) < 0.5);
+    QCOMPARE(history.timeToEmpty(), (qint64)-1);
+    QVERIFY(history.timeToFull()>0);
+}
+
+// the ring and the rates survive a restart
+void TestHistory::persisted()
+{
+    double rate;
+    {
+        BatteryHistory history(file);
+        discharge(&history, 100, 10, 60, HISTORY_EPOCH);
+        rate = history.dischargeRate();
+    }
+    BatteryHistory history(file);
+    QCOMPARE(history.count(), 61);
+    QCOMPARE(history.dischargeRate(), rate);
+}
+
+void TestHistory::critical_data()
+{
+    QTest::addColumn<double>("left");
+    QTest::addColumn<bool>("critical");
+    // 10%/h is 6 min per percent, the default action and margin are 150 s
+    QTest::newRow("hours") << 50.0 << false;
+    QTest::newRow("minutes") << 1.0 << false;
+    QTest::newRow("too late") << 0.3 << true;
+}
+
+void TestHistory::critical()
+{
+    QFETCH(double, left);
+    BatteryHistory history(file);
+    discharge(&history, left+5, 10, 30, HISTORY_EPOCH);
+    QTEST(history.isCritical(), "critical");
+}
+
+// request at 0, PrepareForSleep at 2 s, resume after off seconds
+void TestHistory::actionLearning_data()
+{
+    QTest::addColumn<double>("written");
+    QTest::addColumn<int>("off");
+    QTest::addColumn<double>("learned");
+    QTest::newRow("as expected") << 28.0 << 3600 << (double)BATTERY_ACTION_DEFAULT;
+    QTest::newRow("faster") << 8.0 << 3600 << BATTERY_ACTION_DEFAULT-5.0;
+    QTest::newRow("slower") << 48.0 << 3600 << BATTERY_ACTION_DEFAULT+10.0;
+    QTest::newRow("slow run clamped") << 198.0 << 3600 << (double)(BATTERY_ACTION_DEFAULT+BATTERY_ACTION_STEP);
+    QTest::newRow("no kernel log") << -1.0 << 48 << BATTERY_ACTION_DEFAULT+10.0;
+    QTest::newRow("no kernel log, long off") << -1.0 << BATTERY_ACTION_TIMEOUT << (double)BATTERY_ACTION_DEFAULT;
+}
+
+void TestHistory::actionLearning()
+{
+    QFETCH(double, written);
+    QFETCH(int, off);
+    BatteryHistory history(file);
+    history.startAction(HISTORY_EPOCH);
+    history.sleepAction(HISTORY_EPOCH+2000LL);
+    history.finishAction(HISTORY_EPOCH+2000LL+off*1000LL, written);
+    QTEST(history.actionDuration(), "learned");
+    // only once per request
+    history.sleepAction(HISTORY_EPOCH+2*off*1000LL);
+    history.finishAction(HISTORY_EPOCH+3*off*1000LL, written);
+    QTEST(history.actionDuration(), "learned");
+}
+
+// failed request or resume, a later sleep is not ours
+void TestHistory::actionCancelled()
+{
+    BatteryHistory history(file);
+    history.startAction(HISTORY_EPOCH);
+    history.cancelAction();
+    history.sleepAction(HISTORY_EPOCH+2000LL);
+    history.finishAction(HISTORY_EPOCH+200*1000LL, 100);
+    QCOMPARE(history.actionDuration(), (double)BATTERY_ACTION_DEFAULT);
+}
+
+// sleep long after the request is from somewhere else
+void TestHistory::actionStale()
+{
+    BatteryHistory history(file);
+    history.startAction(HISTORY_EPOCH);
+    history.sleepAction(HISTORY_EPOCH+(BATTERY_ACTION_TIMEOUT+1)*1000LL);
+    history.finishAction(HISTORY_EPOCH+(BATTERY_ACTION_TIMEOUT+10)*1000LL, 1);
+    QCOMPARE(history.actionDuration(), (double)BATTERY_ACTION_DEFAULT);
+}
+
+void TestHistory::imageWriteTime_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<double>("seconds");
+    QTest::newRow("hibernation") << "PM: hibernation: Wrote 1949324 kbytes in 4.72 seconds (412.99 MB/s)" << 4.72;
+    QTest::newRow("old kernel") << "PM: Wrote 1949324 kbytes in 12 seconds (162.44 MB/s)" << 12.0;
+    QTest::newRow("read on resume") << "PM: hibernation: Read 1949324 kbytes in 2.10 seconds (928.25 MB/s)" << -1.0;
+    QTest::newRow("other") << "PM: hibernation: Image saving done" << -1.0;
+}
+
+void TestHistory::imageWriteTime()
+{
+    QFETCH(QString, line);
+    QTEST(KernelLog::imageWriteTime(line), "seconds");
+}
+
+QTEST_MAIN(TestHistory)
+#include "tst_history.moc"
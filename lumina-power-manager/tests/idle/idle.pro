@@ -0,0 +1,15 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# idle stage scheduling on a virtual idle time, no X
+TARGET = tst_idle
+include(../tests.pri)
+SOURCES += tst_idle.cpp idlescheduler.cpp idletimer.cpp xconnection.cpp latencytrace.cpp
+HEADERS += idlescheduler.h idletimer.h xconnection.h latencytrace.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += x11 xext xscrnsaver xrandr
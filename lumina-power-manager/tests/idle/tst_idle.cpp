@@ -0,0 +1,210 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QSignalSpy>
+
+#include "idlescheduler.h"
+
+#define IDLE_SECOND 1000LL
+
+// idle timer without X, the idle time is virtual. an alarm fires when
+// the idle time passes it, like the XSync transition alarm does
+class FakeIdleTimer : public IdleTimer
+{
+public:
+    FakeIdleTimer()
+        : IdleTimer(NULL)
+        , now(0)
+        , armed(0)
+        , msec(0)
+    {
+    }
+    qint64 idleTime()
+    {
+        return now;
+    }
+    void setTimeout(qint64 value, bool rearm = true)
+    {
+        msec = value;
+        if (!rearm && value>0) { return; }
+        arm(msec);
+    }
+    void restart()
+    {
+        if (msec>0) { arm(now+msec); }
+    }
+    void setDeadline(qint64 value)
+    {
+        if (msec>0) { arm(value); }
+    }
+    // idle until value, firing the alarms on the way
+    void advance(qint64 value)
+    {
+        while (armed>0 && armed<=value) {
+            now = armed;
+            armed = 0;
+            emit idle(now);
+        }
+        now = value;
+    }
+    // user input, back to the timeout
+    void activity()
+    {
+        now = 0;
+        arm(msec);
+        emit resumed();
+    }
+    qint64 now;
+    qint64 armed;
+
+private:
+    qint64 msec;
+    void arm(qint64 value)
+    {
+        if (msec<=0) {
+            armed = 0;
+            return;
+        }
+        armed = value<=now?now+1:value;
+    }
+};
+
+// deadline order, restart/retry and settings changed while idle
+class TestIdle : public QObject
+{
+    Q_OBJECT
+
+private:
+    FakeIdleTimer *timer;
+    IdleScheduler *scheduler;
+    QSignalSpy *reached;
+    QList<int> stagesAt(qint64 msec);
+
+private slots:
+    void init();
+    void cleanup();
+    void deadlineOrder();
+    void sameDeadline();
+    void activity();
+    void restart();
+    void retry();
+    void setStageAfterRestart();
+    void setStageWhileIdle();
+};
+
+// dim 10 s, screen off 20 s, lock 30 s, suspend 60 s, set out of order
+void TestIdle::init()
+{
+    timer = new FakeIdleTimer();
+    scheduler = new IdleScheduler(timer);
+    reached = new QSignalSpy(scheduler, SIGNAL(stageReached(int)));
+    scheduler->setStage(IdleScheduler::stageSuspend, 60*IDLE_SECOND);
+    scheduler->setStage(IdleScheduler::stageLock, 30*IDLE_SECOND);
+    scheduler->setStage(IdleScheduler::stageDim, 10*IDLE_SECOND);
+    scheduler->setStage(IdleScheduler::stageScreenOff, 20*IDLE_SECOND);
+}
+
+void TestIdle::cleanup()
+{
+    delete reached;
+    delete scheduler;
+    delete timer;
+}
+
+// stages reached when idle until msec
+QList<int> TestIdle::stagesAt(qint64 msec)
+{
+    reached->clear();
+    timer->advance(msec);
+    QList<int> result;
+    for (int i=0;i<reached->size();++i) { result << reached->at(i).at(0).toInt(); }
+    return result;
+}
+
+// only the nearest deadline is armed, each stage fires at its own
+void TestIdle::deadlineOrder()
+{
+    QCOMPARE(timer->armed, 10*IDLE_SECOND);
+    QCOMPARE(stagesAt(9*IDLE_SECOND), QList<int>());
+    QCOMPARE(stagesAt(10*IDLE_SECOND), QList<int>() << IdleScheduler::stageDim);
+    QCOMPARE(timer->armed, 20*IDLE_SECOND);
+    QCOMPARE(stagesAt(30*IDLE_SECOND), QList<int>() << IdleScheduler::stageScreenOff << IdleScheduler::stageLock);
+    QCOMPARE(timer->armed, 60*IDLE_SECOND);
+    QCOMPARE(stagesAt(120*IDLE_SECOND), QList<int>() << IdleScheduler::stageSuspend);
+    QCOMPARE(timer->armed, 0LL);
+    QCOMPARE(scheduler->activeStages(), (1<<IdleScheduler::stageCount)-1);
+}
+
+void TestIdle::sameDeadline()
+{
+    scheduler->setStage(IdleScheduler::stageLock, 20*IDLE_SECOND);
+    stagesAt(10*IDLE_SECOND);
+    QCOMPARE(stagesAt(20*IDLE_SECOND), QList<int>() << IdleScheduler::stageScreenOff << IdleScheduler::stageLock);
+    QCOMPARE(timer->armed, 60*IDLE_SECOND);
+}
+
+// user input resumes the reached stages and starts over
+void TestIdle::activity()
+{
+    QSignalSpy resumed(scheduler, SIGNAL(resumed(int)));
+    stagesAt(25*IDLE_SECOND);
+    timer->activity();
+    QCOMPARE(resumed.size(), 1);
+    QCOMPARE(resumed.at(0).at(0).toInt(), (1<<IdleScheduler::stageDim)|(1<<IdleScheduler::stageScreenOff));
+    QCOMPARE(scheduler->activeStages(), 0);
+    QCOMPARE(stagesAt(10*IDLE_SECOND), QList<int>() << IdleScheduler::stageDim);
+}
+
+// activity without input, the stages run again from the current idle time
+void TestIdle::restart()
+{
+    QSignalSpy resumed(scheduler, SIGNAL(resumed(int)));
+    stagesAt(25*IDLE_SECOND);
+    scheduler->restart();
+    QCOMPARE(resumed.size(), 1);
+    QCOMPARE(timer->armed, 35*IDLE_SECOND);
+    QCOMPARE(stagesAt(34*IDLE_SECOND), QList<int>());
+    QCOMPARE(stagesAt(35*IDLE_SECOND), QList<int>() << IdleScheduler::stageDim);
+    QCOMPARE(stagesAt(55*IDLE_SECOND), QList<int>() << IdleScheduler::stageScreenOff << IdleScheduler::stageLock);
+}
+
+// an inhibited stage runs after a full timeout, the others stay reached
+void TestIdle::retry()
+{
+    stagesAt(60*IDLE_SECOND);
+    scheduler->retry(1<<IdleScheduler::stageSuspend);
+    QCOMPARE(scheduler->activeStages(), (1<<IdleScheduler::stageSuspend)-1);
+    QCOMPARE(stagesAt(119*IDLE_SECOND), QList<int>());
+    QCOMPARE(stagesAt(120*IDLE_SECOND), QList<int>() << IdleScheduler::stageSuspend);
+}
+
+// a new timeout after a restart counts from the restart,
+// not from an idle time that is already past
+void TestIdle::setStageAfterRestart()
+{
+    stagesAt(40*IDLE_SECOND);
+    scheduler->restart();
+    scheduler->setStage(IdleScheduler::stageDim, 5*IDLE_SECOND);
+    QCOMPARE(timer->armed, 45*IDLE_SECOND);
+    QCOMPARE(stagesAt(45*IDLE_SECOND), QList<int>() << IdleScheduler::stageDim);
+}
+
+// a later deadline while idle is armed from where the run is
+void TestIdle::setStageWhileIdle()
+{
+    stagesAt(25*IDLE_SECOND);
+    scheduler->setStage(IdleScheduler::stageLock, 40*IDLE_SECOND);
+    QCOMPARE(timer->armed, 40*IDLE_SECOND);
+    QCOMPARE(stagesAt(39*IDLE_SECOND), QList<int>());
+    QCOMPARE(stagesAt(40*IDLE_SECOND), QList<int>() << IdleScheduler::stageLock);
+}
+
+QTEST_MAIN(TestIdle)
+#include "tst_idle.moc"
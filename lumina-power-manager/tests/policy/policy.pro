@@ -0,0 +1,12 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# the compiled decision table, no X or D-Bus
+TARGET = tst_policy
+include(../tests.pri)
+SOURCES += tst_policy.cpp policy.cpp
+HEADERS += policy.h
@@ -0,0 +1,147 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+
+#include "policy.h"
+
+Q_DECLARE_METATYPE(PowerPolicy::Event)
+Q_DECLARE_METATYPE(PowerPolicy::Action)
+Q_DECLARE_METATYPE(PowerPolicy::Band)
+
+// lid sleeps on battery and locks on AC, only disabled on AC with an
+// external monitor. auto sleep on battery only, hibernate when critical
+static PowerConfig testConfig()
+{
+    PowerConfig config;
+    config.lowBattery = 15;
+    config.criticalBattery = 5;
+    config.lidBattery = lidSleep;
+    config.lidAC = lidLock;
+    config.autoSleepBattery = 15;
+    config.autoSleepAC = 0;
+    config.criticalAction = criticalHibernate;
+    config.disableLidBatteryExternalMonitor = false;
+    config.disableLidACExternalMonitor = true;
+    return config;
+}
+
+// every event x ac x external x inhibited x band against the expected action
+class TestPolicy : public QObject
+{
+    Q_OBJECT
+
+private:
+    static PowerPolicy::Action expected(PowerPolicy::Event event, bool ac, bool external, bool inhibited, PowerPolicy::Band band);
+
+private slots:
+    void table_data();
+    void table();
+    void bands_data();
+    void bands();
+    void recompile();
+};
+
+PowerPolicy::Action TestPolicy::expected(PowerPolicy::Event event, bool ac, bool external, bool inhibited, PowerPolicy::Band band)
+{
+    switch(event) {
+    case PowerPolicy::eventLidClosed:
+        if (ac) { return external?PowerPolicy::actionNone:PowerPolicy::actionLock; }
+        return PowerPolicy::actionSuspend;
+    case PowerPolicy::eventIdle:
+        return (!ac && !inhibited)?PowerPolicy::actionSuspend:PowerPolicy::actionNone;
+    case PowerPolicy::eventBatteryLow:
+        return (!ac && band<=PowerPolicy::bandLow)?PowerPolicy::actionNotifyLow:PowerPolicy::actionNone;
+    case PowerPolicy::eventBatteryCritical:
+        return (!ac && band == PowerPolicy::bandCritical)?PowerPolicy::actionHibernate:PowerPolicy::actionNone;
+    default: ;
+    }
+    return PowerPolicy::actionNone;
+}
+
+void TestPolicy::table_data()
+{
+    static const char *events[] = { "lid", "idle", "low", "critical" };
+    static const char *bands[] = { "critical", "low", "good", "full", "charged" };
+    QTest::addColumn<PowerPolicy::Event>("event");
+    QTest::addColumn<bool>("ac");
+    QTest::addColumn<bool>("external");
+    QTest::addColumn<bool>("inhibited");
+    QTest::addColumn<PowerPolicy::Band>("band");
+    QTest::addColumn<PowerPolicy::Action>("action");
+
+    for (int event=0;event<PowerPolicy::eventCount;++event) {
+        for (int ac=0;ac<2;++ac) {
+            for (int external=0;external<2;++external) {
+                for (int inhibited=0;inhibited<2;++inhibited) {
+                    for (int band=0;band<PowerPolicy::bandCount;++band) {
+                        QString name = QString("%1 %2%3%4 %5").arg(events[event]).arg(ac?"ac":"battery")
+                                       .arg(external?" external":"").arg(inhibited?" inhibited":"").arg(bands[band]);
+                        QTest::newRow(qPrintable(name)) << (PowerPolicy::Event)event << (bool)ac << (bool)external
+                            << (bool)inhibited << (PowerPolicy::Band)band
+                            << expected((PowerPolicy::Event)event, ac, external, inhibited, (PowerPolicy::Band)band);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TestPolicy::table()
+{
+    QFETCH(PowerPolicy::Event, event);
+    QFETCH(bool, ac);
+    QFETCH(bool, external);
+    QFETCH(bool, inhibited);
+    QFETCH(PowerPolicy::Band, band);
+    QFETCH(PowerPolicy::Action, action);
+
+    PowerPolicy policy(testConfig());
+    QCOMPARE(PowerPolicy::actionName(policy.decide(event, ac, external, inhibited, band)), PowerPolicy::actionName(action));
+}
+
+void TestPolicy::bands_data()
+{
+    QTest::addColumn<double>("percent");
+    QTest::addColumn<PowerPolicy::Band>("band");
+    QTest::newRow("empty") << 0.0 << PowerPolicy::bandCritical;
+    QTest::newRow("critical") << 5.0 << PowerPolicy::bandCritical;
+    QTest::newRow("fraction rounds up") << 5.2 << PowerPolicy::bandLow;
+    QTest::newRow("low") << 15.0 << PowerPolicy::bandLow;
+    QTest::newRow("good") << 16.0 << PowerPolicy::bandGood;
+    QTest::newRow("full") << 90.0 << PowerPolicy::bandFull;
+    QTest::newRow("charged") << 99.0 << PowerPolicy::bandCharged;
+    QTest::newRow("below range") << -1.0 << PowerPolicy::bandCritical;
+    QTest::newRow("above range") << 120.0 << PowerPolicy::bandCharged;
+}
+
+void TestPolicy::bands()
+{
+    QFETCH(double, percent);
+    PowerPolicy policy(testConfig());
+    QTEST(policy.band(percent), "band");
+}
+
+// a new config replaces the whole table
+void TestPolicy::recompile()
+{
+    PowerPolicy policy(testConfig());
+    PowerConfig config = testConfig();
+    config.lidBattery = lidNone;
+    config.autoSleepBattery = 0;
+    config.criticalAction = criticalShutdown;
+    policy.compile(config);
+    QCOMPARE(policy.decide(PowerPolicy::eventLidClosed, false, false, false, PowerPolicy::bandGood), PowerPolicy::actionNone);
+    QCOMPARE(policy.decide(PowerPolicy::eventIdle, false, false, false, PowerPolicy::bandGood), PowerPolicy::actionNone);
+    QCOMPARE(policy.decide(PowerPolicy::eventBatteryCritical, false, false, false, PowerPolicy::bandCritical), PowerPolicy::actionShutdown);
+    QCOMPARE(policy.decide(PowerPolicy::eventLidClosed, true, false, false, PowerPolicy::bandGood), PowerPolicy::actionLock);
+}
+
+QTEST_MAIN(TestPolicy)
+#include "tst_policy.moc"
@@ -0,0 +1,12 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# sysfs power_supply backend on the fixture tree in sysfs/
+TARGET = tst_powersupply
+include(../tests.pri)
+SOURCES += tst_powersupply.cpp powersupply.cpp
+HEADERS += powersupply.h
@@ -0,0 +1,166 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include <QtTest>
+#include <QSignalSpy>
+#include <QDir>
+#include <QFile>
+
+#include "powersupply.h"
+
+// sysfs/ has AC (offline), BAT0 (energy, 45 of 60 Wh, 10 W),
+// BAT1 (charge at 12 V, 12 of 48 Wh, 12 W), BAT2 (capacity 40% only)
+// and a mouse battery (scope Device). BAT2 counts as an average
+// sized battery (54 Wh), the mouse is not counted at all
+#define FIXTURE_AVERAGE 54.0
+#define FIXTURE_BAT2 (FIXTURE_AVERAGE*0.4)
+
+// totals and per battery state, full and incremental reads.
+// the fixture is copied, attributes are changed in place since
+// the backend keeps the files open
+class TestPowerSupply : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString root;
+    void write(const QString &attribute, const QByteArray &value);
+    void removeTree();
+
+private slots:
+    void init();
+    void cleanup();
+    void scan();
+    void totals();
+    void incremental();
+};
+
+void TestPowerSupply::init()
+{
+    root = QDir::temp().filePath(QString("lumina-power-supply-%1").arg(QCoreApplication::applicationPid()));
+    removeTree();
+    QDir fixture(SRCDIR "sysfs");
+    QStringList supplies = fixture.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+    for (int i=0;i<supplies.size();++i) {
+        QDir supply(fixture.filePath(supplies.at(i)));
+        QDir().mkpath(QString("%1/%2").arg(root).arg(supplies.at(i)));
+        QStringList files = supply.entryList(QDir::Files);
+        for (int j=0;j<files.size();++j) {
+            QVERIFY(QFile::copy(supply.filePath(files.at(j)), QString("%1/%2/%3").arg(root).arg(supplies.at(i)).arg(files.at(j))));
+        }
+    }
+}
+
+void TestPowerSupply::cleanup()
+{
+    removeTree();
+}
+
+void TestPowerSupply::removeTree()
+{
+    QDir dir(root);
+    QStringList supplies = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+    for (int i=0;i<supplies.size();++i) {
+        QDir supply(dir.filePath(supplies.at(i)));
+        QStringList files = supply.entryList(QDir::Files);
+        for (int j=0;j<files.size();++j) { supply.remove(files.at(j)); }
+        dir.rmdir(supplies.at(i));
+    }
+    QDir().rmdir(root);
+}
+
+// same inode, like sysfs
+void TestPowerSupply::write(const QString &attribute, const QByteArray &value)
+{
+    QFile file(QString("%1/%2").arg(root).arg(attribute));
+    QVERIFY(file.open(QIODevice::WriteOnly|QIODevice::Truncate));
+    file.write(value+"\n");
+}
+
+// energy and charge batteries are scaled to Wh and W,
+// device batteries are skipped
+void TestPowerSupply::scan()
+{
+    PowerSupply supply(root);
+    QVERIFY(supply.isValid());
+    const PowerSnapshot &snapshot = supply.snapshot();
+    QVERIFY(snapshot.valid);
+    QCOMPARE(snapshot.batteries.size(), 3);
+
+    BatteryState energy = snapshot.batteries.at(0);
+    QCOMPARE(energy.name, QString("BAT0"));
+    QCOMPARE(energy.energy, 45.0);
+    QCOMPARE(energy.energyFull, 60.0);
+    QCOMPARE(energy.power, 10.0);
+    QCOMPARE(energy.percent, 75.0);
+
+    BatteryState charge = snapshot.batteries.at(1);
+    QCOMPARE(charge.name, QString("BAT1"));
+    QCOMPARE(charge.energy, 12.0);
+    QCOMPARE(charge.energyFull, 48.0);
+    QCOMPARE(charge.power, 12.0);
+    QCOMPARE(charge.percent, 25.0);
+
+    BatteryState capacity = snapshot.batteries.at(2);
+    QCOMPARE(capacity.name, QString("BAT2"));
+    QCOMPARE(capacity.energyFull, 0.0);
+    QCOMPARE(capacity.percent, 40.0);
+}
+
+// totals only cover batteries with energy, the percent is
+// weighted by energy with the capacity only battery averaged in
+void TestPowerSupply::totals()
+{
+    PowerSupply supply(root);
+    const PowerSnapshot &snapshot = supply.snapshot();
+    QVERIFY(snapshot.onBattery);
+    QCOMPARE(snapshot.energy, 57.0);
+    QCOMPARE(snapshot.energyFull, 108.0);
+    QCOMPARE(snapshot.rate, 22.0);
+    QCOMPARE(snapshot.percent, (57.0+FIXTURE_BAT2)*100.0/(108.0+FIXTURE_AVERAGE));
+}
+
+// one supply read again adjusts the totals, and ends up where
+// a full read of the same tree does
+void TestPowerSupply::incremental()
+{
+    PowerSupply supply(root);
+    QSignalSpy changed(&supply, SIGNAL(changed()));
+
+    write("BAT0/energy_now", "30000000");
+    supply.refreshDevice("BAT0");
+    QCOMPARE(changed.size(), 1);
+    QCOMPARE(supply.snapshot().energy, 42.0);
+    QCOMPARE(supply.snapshot().percent, (42.0+FIXTURE_BAT2)*100.0/(108.0+FIXTURE_AVERAGE));
+
+    write("BAT1/status", "Charging");
+    supply.refreshDevice("BAT1");
+    QCOMPARE(changed.size(), 2);
+    QCOMPARE(supply.snapshot().rate, -2.0);
+
+    write("AC/online", "1");
+    supply.refreshDevice("AC");
+    QCOMPARE(changed.size(), 3);
+    QVERIFY(!supply.snapshot().onBattery);
+
+    // nothing changed
+    supply.refreshDevice("BAT2");
+    QCOMPARE(changed.size(), 3);
+
+    PowerSupply full(root);
+    QCOMPARE(supply.snapshot().onBattery, full.snapshot().onBattery);
+    QCOMPARE(supply.snapshot().energy, full.snapshot().energy);
+    QCOMPARE(supply.snapshot().energyFull, full.snapshot().energyFull);
+    QCOMPARE(supply.snapshot().rate, full.snapshot().rate);
+    QCOMPARE(supply.snapshot().percent, full.snapshot().percent);
+    QVERIFY(supply.snapshot().batteries == full.snapshot().batteries);
+}
+
+QTEST_MAIN(TestPowerSupply)
+#include "tst_powersupply.moc"
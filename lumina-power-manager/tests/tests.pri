@@ -0,0 +1,21 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# common setup for the power manager tests, include from each test .pro
+QT += core dbus testlib
+lessThan(QT_MAJOR_VERSION, 5): QT += gui
+else: QT -= gui
+
+TEMPLATE = app
+CONFIG += testcase console no_testcase_installs
+CONFIG -= app_bundle
+
+VPATH += $$PWD/../manager $$PWD/common
+INCLUDEPATH += $$PWD/.. $$PWD/../lib $$PWD/../manager $$PWD/common
+DEFINES += SRCDIR=\\\"$$_PRO_FILE_PWD_/\\\"
+
+include(../../lumina-trace/lumina-trace.pri)
@@ -0,0 +1,10 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+# power manager tests, run with make check
+TEMPLATE = subdirs
+SUBDIRS += daemon history policy idle powersupply backlight benchmarks
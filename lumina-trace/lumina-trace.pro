@@ -0,0 +1,21 @@
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+
+QT = core dbus
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = lumina-trace
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include(lumina-trace.pri)
+include(../lumina-extra.pri)
+
+target.path = $${PREFIX}/bin
+INSTALLS += target
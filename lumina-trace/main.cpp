@@ -0,0 +1,65 @@
+/*
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+*/
+
+#include "tracering.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QDBusInterface>
+#include <QDBusReply>
+
+// decode trace dumps, from files or from the running power manager:
+//   lumina-trace <file.trace> ...
+//   lumina-trace --power
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QStringList args = a.arguments();
+    args.removeFirst();
+    if (args.isEmpty()) {
+        err << "usage: lumina-trace <file.trace> ... | --power\n";
+        err.flush();
+        return 1;
+    }
+
+    int result = 0;
+    for (int i=0;i<args.size();++i) {
+        QByteArray data;
+        if (args.at(i) == "--power") {
+            QDBusInterface iface("org.lumina.PowerManager", "/PowerManager", "org.lumina.PowerManager", QDBusConnection::sessionBus());
+            QDBusReply<QByteArray> reply = iface.call("Trace");
+            if (!reply.isValid()) {
+                err << reply.error().message() << "\n";
+                err.flush();
+                result = 1;
+                continue;
+            }
+            data = reply.value();
+        } else {
+            QFile file(args.at(i));
+            if (!file.open(QIODevice::ReadOnly)) {
+                err << file.fileName() << ": " << file.errorString() << "\n";
+                err.flush();
+                result = 1;
+                continue;
+            }
+            data = file.readAll();
+        }
+        QStringList lines = TraceRing::decode(data);
+        if (lines.isEmpty()) {
+            err << args.at(i) << ": not a trace dump\n";
+            err.flush();
+            result = 1;
+            continue;
+        }
+        out << lines.join("\n") << "\n";
+        out.flush();
+    }
+    return result;
+}
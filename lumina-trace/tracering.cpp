@@ -0,0 +1,226 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#include "tracering.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QDateTime>
+
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+static TraceRecord traceRing[TRACE_RING_SIZE];
+static QAtomicInt traceNext(0);
+static char traceName[32];
+static char traceFile[256];
+
+// names and argument labels for the decoder
+struct TraceEventInfo
+{
+    int event;
+    const char *name;
+    const char *args;
+};
+
+static const TraceEventInfo traceEvents[] = {
+    { tracePowerStartup, "power.startup", "point msec" },
+    { tracePowerState, "power.state", "percent10 band battery" },
+    { tracePowerSource, "power.source", "battery" },
+    { tracePowerLidClosed, "power.lid-closed", "action" },
+    { tracePowerLidOpened, "power.lid-opened", "" },
+    { tracePowerAction, "power.action", "action" },
+    { tracePowerSleep, "power.sleep", "sleep" },
+    { tracePowerCritical, "power.critical", "action time-to-empty action-duration" },
+    { tracePowerIdleStage, "power.idle-stage", "stage inhibited" },
+    { tracePowerIdleResumed, "power.idle-resumed", "stages" },
+    { tracePowerInhibit, "power.inhibit", "inhibited" },
+    { tracePowerHotplug, "power.hotplug", "events restored ok usec" },
+    { tracePowerSettings, "power.settings", "changed" },
+    { tracePowerInhibitAdd, "power.inhibit-add", "cookie kind owner" },
+    { tracePowerInhibitRemove, "power.inhibit-remove", "cookie kind held" },
+    { traceDiskFound, "disk.found", "device" },
+    { traceDiskMedia, "disk.media", "device media" },
+    { traceDiskMount, "disk.mount", "device mounted" },
+    { traceDiskError, "disk.error", "device" },
+    { traceNone, NULL, NULL }
+};
+
+static qint64 clockNsec(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (qint64)ts.tv_sec*1000000000LL+ts.tv_nsec;
+}
+
+// async-signal-safe, used by the signal handler
+static void fillHeader(TraceHeader *header)
+{
+    memset(header, 0, sizeof(TraceHeader));
+    header->magic = TRACE_MAGIC;
+    header->version = TRACE_VERSION;
+    header->recordSize = sizeof(TraceRecord);
+    header->size = TRACE_RING_SIZE;
+    header->next = (quint32)traceNext.fetchAndAddRelaxed(0);
+    header->pid = getpid();
+    header->realtime = clockNsec(CLOCK_REALTIME);
+    header->monotonic = clockNsec(CLOCK_MONOTONIC);
+    memcpy(header->name, traceName, sizeof(header->name));
+}
+
+// write the raw ring, no allocations or locks
+static void handleTraceSignal(int)
+{
+    int saved = errno;
+    int fd = ::open(traceFile, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    if (fd>=0) {
+        TraceHeader header;
+        fillHeader(&header);
+        ssize_t ret = ::write(fd, &header, sizeof(header));
+        ret = ::write(fd, traceRing, sizeof(traceRing));
+        Q_UNUSED(ret)
+        ::close(fd);
+    }
+    errno = saved;
+}
+
+void TraceRing::setName(const QString &name)
+{
+    QByteArray value = name.toLocal8Bit();
+    memset(traceName, 0, sizeof(traceName));
+    strncpy(traceName, value.constData(), sizeof(traceName)-1);
+}
+
+// a slot is claimed with one atomic add, the sequence is stored last
+// so a dump can skip slots that are being written.
+void TraceRing::record(int event, qint32 a0, qint32 a1, qint32 a2, qint32 a3)
+{
+    quint32 sequence = (quint32)traceNext.fetchAndAddRelaxed(1);
+    TraceRecord *record = &traceRing[sequence & (TRACE_RING_SIZE-1)];
+    record->sequence = 0;
+    record->timestamp = clockNsec(CLOCK_MONOTONIC);
+    record->event = event;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+    __sync_synchronize();
+    record->sequence = sequence+1;
+}
+
+QByteArray TraceRing::dump()
+{
+    TraceHeader header;
+    fillHeader(&header);
+    QByteArray result((const char*)&header, sizeof(header));
+    result.append((const char*)traceRing, sizeof(traceRing));
+    return result;
+}
+
+// dump to <runtime dir>/<name>-<pid>.trace when signal is received
+void TraceRing::installSignalHandler(int signal)
+{
+    QByteArray fileName = QFile::encodeName(dumpFileName());
+    memset(traceFile, 0, sizeof(traceFile));
+    strncpy(traceFile, fileName.constData(), sizeof(traceFile)-1);
+
+    struct sigaction action;
+    action.sa_handler = handleTraceSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(signal, &action, 0);
+}
+
+QString TraceRing::dumpFileName()
+{
+    QString dir = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+    if (dir.isEmpty()) { dir = QDir::tempPath(); }
+    QString name = QString::fromLocal8Bit(traceName);
+    if (name.isEmpty()) { name = "lumina"; }
+    return QString("%1/%2-%3.trace").arg(dir).arg(name).arg(getpid());
+}
+
+const char *TraceRing::eventName(int event)
+{
+    for (int i=0;traceEvents[i].name;++i) {
+        if (traceEvents[i].event == event) { return traceEvents[i].name; }
+    }
+    return NULL;
+}
+
+// records of a dump, oldest first. empty if data is not a dump
+QList<TraceRecord> TraceRing::records(const QByteArray &data, TraceHeader *header)
+{
+    QList<TraceRecord> result;
+    TraceHeader dump;
+    if (data.size()<(int)sizeof(dump)) { return result; }
+    memcpy(&dump, data.constData(), sizeof(dump));
+    if (dump.magic != TRACE_MAGIC || dump.version != TRACE_VERSION ||
+        dump.recordSize != sizeof(TraceRecord) ||
+        data.size()<(int)(sizeof(dump)+(qint64)dump.size*dump.recordSize)) { return result; }
+
+    QMap<quint32, TraceRecord> sorted;
+    const TraceRecord *ring = (const TraceRecord*)(data.constData()+sizeof(dump));
+    for (quint32 i=0;i<dump.size;++i) {
+        if (ring[i].sequence == 0) { continue; }
+        sorted.insert(ring[i].sequence, ring[i]);
+    }
+    if (header) { *header = dump; }
+    return sorted.values();
+}
+
+// one line per record, oldest first, with wall clock time
+QStringList TraceRing::decode(const QByteArray &data)
+{
+    QStringList result;
+    TraceHeader header;
+    QList<TraceRecord> records = TraceRing::records(data, &header);
+    if (records.isEmpty()) { return result; }
+
+    quint32 count = records.size();
+    quint32 lost = header.next>count?header.next-count:0;
+    result << QString("# %1 pid %2, %3 events, %4 recorded, %5 overwritten")
+              .arg(QString::fromLocal8Bit(header.name, qstrnlen(header.name, sizeof(header.name))))
+              .arg(header.pid).arg(header.next).arg(count).arg(lost);
+
+    for (int i=0;i<records.size();++i) {
+        const TraceRecord &record = records.at(i);
+        qint64 wall = header.realtime+(record.timestamp-header.monotonic);
+        QString line = QString("%1.%2 %3")
+                       .arg(QDateTime::fromMSecsSinceEpoch(wall/1000000).toString("yyyy-MM-dd hh:mm:ss"))
+                       .arg(wall%1000000000/1000, 6, 10, QChar('0'))
+                       .arg(record.sequence-1);
+        const char *name = eventName(record.event);
+        QStringList labels;
+        for (int j=0;traceEvents[j].name;++j) {
+            if (traceEvents[j].event == record.event) {
+#if QT_VERSION >= 0x050e00
+                labels = QString(traceEvents[j].args).split(" ", Qt::SkipEmptyParts);
+#else
+                labels = QString(traceEvents[j].args).split(" ", QString::SkipEmptyParts);
+#endif
+                break;
+            }
+        }
+        if (name) { line.append(QString(" %1").arg(name)); }
+        else { line.append(QString(" 0x%1").arg(record.event, 0, 16)); }
+        for (int j=0;j<TRACE_ARGS;++j) {
+            if (j<labels.size()) { line.append(QString(" %1=%2").arg(labels.at(j)).arg(record.args[j])); }
+            else if (!name) { line.append(QString(" %1").arg(record.args[j])); }
+        }
+        result << line;
+    }
+    return result;
+}
@@ -0,0 +1,93 @@
+/*
+#
+# Copyright (c) 2018, Ole-André Rodlie <ole.andre.rodlie@gmail.com> All rights reserved.
+#
+# Available under the 3-clause BSD license
+# See the LICENSE file for full details
+#
+*/
+
+#ifndef TRACERING_H
+#define TRACERING_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+// records, must be a power of two
+#define TRACE_RING_SIZE 4096
+#define TRACE_ARGS 4
+#define TRACE_MAGIC 0x4c545243
+#define TRACE_VERSION 1
+
+// one event, timestamp is CLOCK_MONOTONIC in nsec.
+// sequence is written last, 0 is an unused slot.
+struct TraceRecord
+{
+    qint64 timestamp;
+    quint32 sequence;
+    quint16 event;
+    quint16 reserved;
+    qint32 args[TRACE_ARGS];
+};
+
+// dump header, followed by the ring as is (TRACE_RING_SIZE records).
+// both clocks are read at dump time to get wall time for records.
+struct TraceHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 recordSize;
+    quint32 size;
+    quint32 next;
+    qint32 pid;
+    qint64 realtime;
+    qint64 monotonic;
+    char name[32];
+};
+
+// event ids, grouped by daemon. never reuse or renumber, old dumps must decode.
+enum TraceEvent
+{
+    traceNone = 0,
+
+    tracePowerStartup = 0x100,
+    tracePowerState,
+    tracePowerSource,
+    tracePowerLidClosed,
+    tracePowerLidOpened,
+    tracePowerAction,
+    tracePowerSleep,
+    tracePowerCritical,
+    tracePowerIdleStage,
+    tracePowerIdleResumed,
+    tracePowerInhibit,
+    tracePowerHotplug,
+    tracePowerSettings,
+    tracePowerInhibitAdd,
+    tracePowerInhibitRemove,
+
+    traceDiskFound = 0x200,
+    traceDiskMedia,
+    traceDiskMount,
+    traceDiskError
+};
+
+// always on in-memory trace, one per process.
+// record() is lock free and cheap enough for hot paths,
+// dump on demand (D-Bus) or on a signal.
+class TraceRing
+{
+public:
+    static void setName(const QString &name);
+    static void record(int event, qint32 a0 = 0, qint32 a1 = 0, qint32 a2 = 0, qint32 a3 = 0);
+    static QByteArray dump();
+    static void installSignalHandler(int signal);
+    static QString dumpFileName();
+    static const char *eventName(int event);
+    static QList<TraceRecord> records(const QByteArray &data, TraceHeader *header = NULL);
+    static QStringList decode(const QByteArray &data);
+};
+
+#endif // TRACERING_H